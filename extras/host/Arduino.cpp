@@ -0,0 +1,32 @@
+/*
+ *	Simulated clock for the host build.
+ */
+
+#include "Arduino.h"
+
+static unsigned long _mockMicros = 0;
+
+unsigned long micros()
+{
+    return _mockMicros;
+}
+
+unsigned long millis()
+{
+    return _mockMicros / 1000;
+}
+
+void delay(unsigned long ms)
+{
+    _mockMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    _mockMicros += us;
+}
+
+void mockAdvanceMicros(unsigned long us)
+{
+    _mockMicros += us;
+}
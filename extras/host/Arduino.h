@@ -0,0 +1,64 @@
+/*
+ *	Minimal Arduino core stand-in for building the CAP129n library on a
+ *	Linux host. Time is simulated, it only moves when the mock bus or the
+ *	caller advances it.
+ */
+
+#ifndef __CAP129n_HOST_ARDUINO_H__
+#define __CAP129n_HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t data) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size-- && write(*buffer++))
+      n++;
+    return n;
+  }
+  virtual int availableForWrite() { return 0; }
+
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(unsigned long n)
+  {
+    char digits[11];
+    char *p = &digits[sizeof(digits) - 1];
+    *p = '\0';
+    do
+    {
+      *--p = '0' + n % 10;
+      n /= 10;
+    } while (n);
+    return print(p);
+  }
+  size_t println() { return print("\r\n"); }
+  size_t println(const char *s) { return print(s) + println(); }
+  size_t println(unsigned long n) { return print(n) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// Host only, moves the simulated clock forward
+void mockAdvanceMicros(unsigned long us);
+
+#endif
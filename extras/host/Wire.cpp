@@ -0,0 +1,301 @@
+/*
+ *	Host-side TwoWire stand-in emulating the CAP1293/6/8 register file.
+ */
+
+#include "Wire.h"
+#include "CAP129n_registers.h"
+
+TwoWire Wire;
+
+//-----BEGIN EMULATED DEVICE-----
+
+/*
+ *	Loads the power-on defaults from the datasheet register map.
+ */
+void MockCAP129n::reset(uint8_t addr, uint8_t prodId)
+{
+    address = addr;
+    memset(regs, 0x00, sizeof(regs));
+    regs[SENSITIVITY_CONTROL] = 0x2F;
+    regs[CONFIG] = 0x20;
+    regs[SENSOR_INPUT_ENABLE] = 0xFF;
+    regs[SENSOR_INPUT_CONFIG] = 0xA4;
+    regs[SENSOR_INPUT_CONFIG_2] = 0x07;
+    regs[AVERAGING_AND_SAMPLE_CONFIG] = 0x39;
+    regs[INTERRUPT_ENABLE] = 0xFF;
+    regs[REPEAT_RATE_ENABLE] = 0xFF;
+    regs[MULTIPLE_TOUCH_CONFIG] = 0x80;
+    regs[MULTIPLE_TOUCH_PATTERN] = 0xFF;
+    regs[RECALIBRATION_CONFIG] = 0x8A;
+    for (int i = SENSOR_1_INPUT_THRESH; i <= SENSOR_8_INPUT_THRESH; i++)
+        regs[i] = 0x40;
+    regs[SENSOR_INPUT_NOISE_THRESH] = 0x01;
+    regs[STANDBY_CONFIG] = 0x39;
+    regs[STANDBY_SENSITIVITY] = 0x02;
+    regs[STANDBY_THRESH] = 0x40;
+    regs[CONFIG_2] = 0x40;
+    regs[POWER_BUTTON_CONFIG] = 0x22;
+    for (int i = SENSOR_INPUT_1_BASE_COUNT; i <= SENSOR_INPUT_8_BASE_COUNT; i++)
+        regs[i] = 0xC8;
+    regs[PROD_ID] = prodId;
+    regs[MANUFACTURE_ID] = 0x5D;
+    regs[REVISION] = 0x00;
+    _pointer = 0;
+    _touched = 0;
+    _powerHeld = false;
+}
+
+void MockCAP129n::setTouched(uint8_t mask)
+{
+    uint8_t changed = (mask ^ _touched) & regs[SENSOR_INPUT_ENABLE];
+    _touched = mask;
+    latch(changed);
+}
+
+void MockCAP129n::setDeltaCount(uint8_t id, int8_t count)
+{
+    if (id >= 1 && id <= 8)
+        regs[SENSOR_INPUT_1_DELTA_COUNT + id - 1] = (uint8_t)count;
+}
+
+void MockCAP129n::setPowerButtonHeld(bool held)
+{
+    _powerHeld = held;
+    if (held)
+    {
+        regs[GENERAL_STATUS] |= 0x10;
+        regs[MAIN_CONTROL] |= 0x01;
+    }
+}
+
+/*
+ *	Status bits latch until INT is cleared. Presses always assert INT,
+ *	releases only when INT_REL_n in CONFIG_2 is 0.
+ */
+void MockCAP129n::latch(uint8_t changed)
+{
+    uint8_t pressed = changed & _touched;
+    uint8_t released = changed & ~_touched;
+    regs[SENSOR_INPUT_STATUS] |= _touched & regs[SENSOR_INPUT_ENABLE];
+    if (regs[SENSOR_INPUT_STATUS])
+        regs[GENERAL_STATUS] |= 0x01;
+
+    bool intOnRelease = (regs[CONFIG_2] & 0x01) == 0;
+    if ((pressed & regs[INTERRUPT_ENABLE]) || (intOnRelease && (released & regs[INTERRUPT_ENABLE])))
+        regs[MAIN_CONTROL] |= 0x01;
+}
+
+void MockCAP129n::setPointer(uint8_t reg)
+{
+    _pointer = reg;
+}
+
+uint8_t MockCAP129n::readNext()
+{
+    return regs[_pointer++];
+}
+
+void MockCAP129n::writeNext(uint8_t data)
+{
+    uint8_t reg = _pointer++;
+    switch (reg)
+    {
+    case MAIN_CONTROL:
+        regs[reg] = data;
+        if ((data & 0x01) == 0)
+        {
+            // Clearing INT re-latches the inputs that are still touched
+            regs[SENSOR_INPUT_STATUS] = _touched & regs[SENSOR_INPUT_ENABLE];
+            regs[GENERAL_STATUS] = regs[SENSOR_INPUT_STATUS] ? 0x01 : 0x00;
+            if (_powerHeld)
+                regs[GENERAL_STATUS] |= 0x10;
+        }
+        break;
+    case CALIBRATION_ACTIVATE_AND_STATUS:
+        // Calibration completes instantly on the host
+        break;
+    case SENSOR_1_INPUT_THRESH:
+        // BUT_LD_TH copies the input 1 threshold to every input
+        if (regs[RECALIBRATION_CONFIG] & 0x80)
+            memset(&regs[SENSOR_1_INPUT_THRESH], data, SENSOR_8_INPUT_THRESH - SENSOR_1_INPUT_THRESH + 1);
+        regs[reg] = data;
+        break;
+    case GENERAL_STATUS:
+    case SENSOR_INPUT_STATUS:
+    case NOISE_FLAG_STATUS:
+    case BASE_COUNT_OUT:
+    case PROD_ID:
+    case MANUFACTURE_ID:
+    case REVISION:
+        break;
+    default:
+        if ((reg >= SENSOR_INPUT_1_DELTA_COUNT && reg <= SENSOR_INPUT_8_DELTA_COUNT) ||
+            (reg >= SENSOR_INPUT_1_BASE_COUNT && reg <= SENSOR_INPUT_8_BASE_COUNT))
+            break;
+        regs[reg] = data;
+        break;
+    }
+}
+
+//-----END EMULATED DEVICE-----
+
+TwoWire::TwoWire()
+{
+    _deviceCount = 0;
+    _frequency = 100000;
+    _txLength = 0;
+    _rxLength = 0;
+    _rxIndex = 0;
+    _faults = 0;
+    _faultSkip = 0;
+    _faultShortRead = false;
+    resetStats();
+}
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::setClock(uint32_t frequency)
+{
+    _frequency = frequency;
+}
+
+MockCAP129n *TwoWire::attachDevice(uint8_t address, uint8_t prodId)
+{
+    MockCAP129n *dev = device(address);
+    if (dev == NULL)
+    {
+        if (_deviceCount >= MOCK_MAX_DEVICES)
+            return NULL;
+        dev = &_devices[_deviceCount++];
+    }
+    dev->reset(address, prodId);
+    return dev;
+}
+
+MockCAP129n *TwoWire::device(uint8_t address)
+{
+    for (int i = 0; i < _deviceCount; i++)
+    {
+        if (_devices[i].address == address)
+            return &_devices[i];
+    }
+    return NULL;
+}
+
+void TwoWire::injectFaults(uint8_t count, bool shortRead, uint8_t skip)
+{
+    _faults = count;
+    _faultSkip = skip;
+    _faultShortRead = shortRead;
+}
+
+void TwoWire::resetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ *	Every byte is 8 data bits plus ACK, START/STOP are one bit time each.
+ *	A transaction is counted when the bus is released.
+ */
+void TwoWire::account(uint8_t payloadBytes, bool start, bool stop)
+{
+    unsigned long bits = 9UL * (payloadBytes + 1);
+    if (start)
+        bits++;
+    if (stop)
+    {
+        bits++;
+        stats.transactions++;
+    }
+    unsigned long us = (bits * 1000000UL + _frequency - 1) / _frequency;
+    stats.bytes += payloadBytes;
+    stats.busMicros += us;
+    mockAdvanceMicros(us);
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    _txAddress = address;
+    _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (_txLength >= sizeof(_txBuffer))
+        return 0;
+    _txBuffer[_txLength++] = data;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    MockCAP129n *dev = device(_txAddress);
+    if (_faults > 0 && !_faultShortRead && _faultSkip > 0)
+    {
+        _faultSkip--;
+    }
+    else if (_faults > 0 && !_faultShortRead)
+    {
+        _faults--;
+        dev = NULL;
+    }
+    if (dev == NULL)
+    {
+        account(0, true, true);
+        stats.nacks++;
+        return 2;
+    }
+
+    if (_txLength > 0)
+    {
+        dev->setPointer(_txBuffer[0]);
+        for (int i = 1; i < _txLength; i++)
+            dev->writeNext(_txBuffer[i]);
+    }
+    account(_txLength, true, sendStop);
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop)
+{
+    MockCAP129n *dev = device(address);
+    _rxLength = 0;
+    _rxIndex = 0;
+    if (dev == NULL)
+    {
+        account(0, true, true);
+        stats.nacks++;
+        return 0;
+    }
+    if (quantity > sizeof(_rxBuffer))
+        quantity = sizeof(_rxBuffer);
+
+    if (_faults > 0 && _faultShortRead && quantity > 0 && _faultSkip > 0)
+    {
+        _faultSkip--;
+    }
+    else if (_faults > 0 && _faultShortRead && quantity > 0)
+    {
+        _faults--;
+        quantity--;
+    }
+    for (int i = 0; i < quantity; i++)
+        _rxBuffer[_rxLength++] = dev->readNext();
+    account(quantity, true, sendStop);
+    return _rxLength;
+}
+
+int TwoWire::available()
+{
+    return _rxLength - _rxIndex;
+}
+
+int TwoWire::read()
+{
+    if (_rxIndex >= _rxLength)
+        return -1;
+    return _rxBuffer[_rxIndex++];
+}
@@ -0,0 +1,95 @@
+/*
+ *	Host-side TwoWire stand-in. Emulates the register file of one or more
+ *	CAP1293/6/8 parts and counts every transaction, byte and the time it
+ *	would take on a real bus.
+ */
+
+#ifndef __CAP129n_HOST_WIRE_H__
+#define __CAP129n_HOST_WIRE_H__
+
+#include "Arduino.h"
+
+#define MOCK_MAX_DEVICES 8
+
+// Emulated CAP129n register file
+class MockCAP129n
+{
+public:
+  void reset(uint8_t address, uint8_t prodId);
+  
+  // Simulate a finger on the inputs in "mask", latches status and INT like the chip
+  void setTouched(uint8_t mask);
+  void setDeltaCount(uint8_t id, int8_t count);
+  // Simulate the power button reaching its hold time, PWR stays set until released
+  void setPowerButtonHeld(bool held);
+  
+  uint8_t readNext();
+  void writeNext(uint8_t data);
+  void setPointer(uint8_t reg);
+  
+  uint8_t address;
+  uint8_t regs[256];
+  
+private:
+  void latch(uint8_t newlyChanged);
+  
+  uint8_t _pointer;
+  uint8_t _touched;
+  bool _powerHeld;
+};
+
+// Bus statistics since the last resetStats()
+struct MockBusStats
+{
+  unsigned long transactions;
+  unsigned long bytes;
+  unsigned long busMicros;
+  unsigned long nacks;
+};
+
+class TwoWire
+{
+public:
+  TwoWire();
+  
+  void begin();
+  void setClock(uint32_t frequency);
+  
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+  int available();
+  int read();
+  
+  // Host only
+  MockCAP129n *attachDevice(uint8_t address, uint8_t prodId);
+  MockCAP129n *device(uint8_t address);
+  void resetStats();
+  MockBusStats stats;
+  // Fail "count" transfers after letting "skip" through, with an address NACK or by returning one byte short
+  void injectFaults(uint8_t count, bool shortRead = false, uint8_t skip = 0);
+  
+private:
+  void account(uint8_t payloadBytes, bool start, bool stop);
+  
+  MockCAP129n _devices[MOCK_MAX_DEVICES];
+  uint8_t _deviceCount;
+  uint32_t _frequency;
+  
+  uint8_t _txAddress;
+  uint8_t _txBuffer[32];
+  uint8_t _txLength;
+  
+  uint8_t _rxBuffer[32];
+  uint8_t _rxLength;
+  uint8_t _rxIndex;
+  
+  uint8_t _faults;
+  uint8_t _faultSkip;
+  bool _faultShortRead;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,897 @@
+/*
+ *	Counts the I2C cost of the public CAP129n calls against the host mock
+ *	and checks the counts and results. Run with "make bench" from this
+ *	directory, it exits non-zero if a check failed.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "CAP129n.h"
+#include "CAP129n_async.h"
+#include "CAP129n_bus.h"
+#include "CAP129n_profile.h"
+#include "CAP129n_model.h"
+#include "CAP129n_logger.h"
+#include "CAP129n_scheduler.h"
+#include "CAP129n_linux.h"
+#include "CAP129n_dispatch.h"
+#include "CAP129n_tune.h"
+#include "CAP129n_gestures.h"
+#include "CAP129n_slider.h"
+
+static unsigned long checks = 0;
+static unsigned long failures = 0;
+
+#define CHECK(cond)                                                 \
+    do                                                              \
+    {                                                               \
+        checks++;                                                   \
+        if (!(cond))                                                \
+        {                                                           \
+            failures++;                                             \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        }                                                           \
+    } while (0)
+
+static void report(const char *name, const MockBusStats &s)
+{
+    printf("%-32s %6lu %6lu %8lu\n", name, s.transactions, s.bytes, s.busMicros);
+}
+
+static void expectCount(const char *name, unsigned long count, unsigned long expected, int line)
+{
+    checks++;
+    if (count == expected)
+        return;
+    failures++;
+    printf("FAIL %s:%d: %s took %lu, expected %lu\n", __FILE__, line, name, count, expected);
+}
+
+// Runs "call" and checks it took "expected" bus transactions
+#define BENCH(name, expected, call) \
+    do                              \
+    {                               \
+        Wire.resetStats();          \
+        call;                       \
+        report(name, Wire.stats);   \
+        expectCount(name, Wire.stats.transactions, expected, __LINE__); \
+    } while (0)
+
+// A Print that counts bytes and, like most, does not report free space
+class CountingPrint : public Print
+{
+public:
+    unsigned long count = 0;
+    size_t write(uint8_t data) { (void)data; count++; return 1; }
+};
+
+// Services "async" until idle, "stepMicros" apart, checks every call stays within one transaction and returns the transactions made
+static unsigned long serviceAsync(CAP129nAsync &async, unsigned long stepMicros)
+{
+    unsigned long transactions = 0;
+    unsigned long worst = 0;
+    while (!async.isIdle())
+    {
+        Wire.resetStats();
+        async.service();
+        if (Wire.stats.transactions > worst)
+            worst = Wire.stats.transactions;
+        transactions += Wire.stats.transactions;
+        mockAdvanceMicros(stepMicros);
+    }
+    CHECK(worst <= 1);
+    return transactions;
+}
+
+static void asyncDone(uint16_t handle, uint8_t type, int status, void *context)
+{
+    (void)handle;
+    (void)type;
+    *(int *)context = status;
+}
+
+static void benchModel(const char *label, uint8_t model)
+{
+    CAP129n cap(model);
+    MockCAP129n *dev = Wire.attachDevice(DEFAULT_I2C_ADDR, model);
+    uint8_t channels = cap.getChannelCount();
+    int8_t deltas[8];
+    uint8_t bases[8];
+    int status;
+    uint8_t result;
+
+    printf("\n%s\n", label);
+    printf("%-32s %6s %6s %8s\n", "call", "trans", "bytes", "bus_us");
+
+    static constexpr CAP129nConfig startup = CAP129nConfig().withSignalGuardMask(0x00);
+    dev->regs[0x25] = 0x5A;	//Reserved, must not be overwritten
+    dev->regs[0x2C] = 0xA5;
+    BENCH("beginFast", 7, status = cap.beginFast(startup, Wire));
+    CHECK(status == BEGIN_SUCCESS && dev->regs[0x25] == 0x5A && dev->regs[0x2C] == 0xA5);
+    Wire.injectFaults(3, false, 1);
+    BENCH("beginFast, config push failed", 4, status = cap.beginFast(startup, Wire));
+    CHECK(status == ERR_I2C_NACK);
+    Wire.injectFaults(3, false, 6);
+    BENCH("beginFast, MAIN_CONTROL failed", 9, status = cap.beginFast(startup, Wire));
+    CHECK(status == ERR_I2C_NACK);
+    CHECK(cap.beginFast(startup, Wire, DEFAULT_I2C_ADDR + 1) == ERR_NO_DEVICE_AT_ADDRESS);
+    Wire.injectFaults(3, true);
+    CHECK(cap.beginFast(startup, Wire) == ERR_I2C_SHORT_READ);
+    printf("%-32s %22lu\n", "  getStartupTime() us", cap.getStartupTime());
+    dev->reset(DEFAULT_I2C_ADDR, model);
+    BENCH("begin", 11, status = cap.begin(Wire));
+    CHECK(status == BEGIN_SUCCESS);
+    printf("%-32s %22lu\n", "  getStartupTime() us", cap.getStartupTime());
+    CAP129nWireTransport transport(Wire);
+    dev->reset(DEFAULT_I2C_ADDR, model);
+    BENCH("begin(transport)", 11, status = cap.begin(transport));
+    CHECK(status == BEGIN_SUCCESS);
+    BENCH("isConnected", 1, CHECK(cap.isConnected()));
+    BENCH("setSensitivity", 1, cap.setSensitivity(SENSITIVITY_64X));
+    BENCH("getSensitivity", 0, CHECK(cap.getSensitivity() == 64));
+    BENCH("enableSMBusTimeout", 1, cap.enableSMBusTimeout());
+    BENCH("setMaximumHoldDuration", 2, cap.setMaximumHoldDuration(MAX_DURRATION_840));
+    BENCH("enableInterruptOnRelease", 1, cap.enableInterruptOnRelease());
+    BENCH("calibrateTouch", 1, cap.calibrateTouch(1));
+    BENCH("enableSensing", 1, cap.enableSensing(1));
+    CHECK(dev->regs[SENSITIVITY_CONTROL] >> 4 == SENSITIVITY_64X);
+    CHECK(dev->regs[SENSOR_INPUT_CONFIG] >> 4 == MAX_DURRATION_840);
+
+    static constexpr CAP129nConfig panel = CAP129nConfig()
+        .withSensitivity(SENSITIVITY_64X)
+        .withThresholds(0x30)
+        .withRepeatMask(0x00)
+        .withMaximumHoldDuration(MAX_DURRATION_840);
+    BENCH("apply(profile) changed", 2, CHECK(cap.apply(panel) == 2));
+    BENCH("apply(profile) unchanged", 0, CHECK(cap.apply(panel) == 0));
+    BENCH("apply(profile, force)", 3, CHECK(cap.apply(panel, true) == 3));
+    CHECK(dev->regs[SENSOR_1_INPUT_THRESH] == 0x30 && dev->regs[REPEAT_RATE_ENABLE] == 0x00);
+
+    uint8_t thresholds[8] = {0x40, 0x38, 0x30, 0x28, 0x40, 0x38, 0x30, 0x28};
+    uint8_t noiseThreshold = 0;
+    BENCH("setThresholds", 1, cap.setThresholds(thresholds, 0x01));
+    memset(thresholds, 0, sizeof(thresholds));
+    BENCH("readThresholds", 1, CHECK(cap.readThresholds(thresholds, noiseThreshold) == I2C_SUCCESS));
+    CHECK(thresholds[0] == 0x40 && thresholds[7] == 0x28 && noiseThreshold == 0x01);
+    BENCH("setThreshold(2)", 1, cap.setThreshold(2, 0x20));
+    CHECK(cap.getThreshold(2) == 0x20 && dev->regs[SENSOR_2_INPUT_THRESH] == 0x20);
+
+    BENCH("isTouched() idle", 1, CHECK(!cap.isTouched()));
+    dev->setTouched(0x01);
+    BENCH("isTouched() touched", 2, CHECK(cap.isTouched()));
+    BENCH("isTouched(1) touched", 2, CHECK(cap.isTouched(1)));
+    BENCH("isTouched(1..n) scan", 1 + channels, for (uint8_t i = 1; i <= channels; i++) CHECK(cap.isTouched(i) == (i == 1)));
+    BENCH("getInputStatus", 2, CHECK(cap.getInputStatus() == 0x01));
+    dev->setTouched(0x03);
+    BENCH("poll() touched", 2, CHECK(cap.poll().inputStatus == 0x03));
+    BENCH("poll() idle", 1, CHECK(cap.poll().inputStatus == 0x03));
+    CAP129nDispatcher dispatcher;
+    BENCH("dispatcher update(device)", 1, dispatcher.update(cap));
+    cap.setNoiseCapture(true);
+    BENCH("poll() idle, noise capture", 1, cap.poll());
+    CHECK(cap.getNoiseCaptures() == 1);
+    cap.setNoiseCapture(false);
+    dev->setTouched(0x00);
+
+    TouchEvent event;
+    cap.setAlertMode(true);
+    while (cap.service())
+        ;
+    while (cap.readEvent(event))
+        ;
+    BENCH("service() alert idle", 0, CHECK(cap.service() == 0));
+    dev->setTouched(0x04);
+    cap.handleAlert();
+    BENCH("service() alert press", 2, CHECK(cap.service() == 1));
+    dev->setTouched(0x00);
+    cap.handleAlert();
+    BENCH("service() alert release", 2, cap.service());
+    while (cap.service())	//The release shows once the latched status is cleared
+        ;
+    CHECK(cap.readEvent(event) && event.channel == 3 && event.type == TOUCH_EVENT_PRESS);
+    CHECK(cap.readEvent(event) && event.channel == 3 && event.type == TOUCH_EVENT_RELEASE);
+    CHECK(!cap.readEvent(event));
+    cap.setAlertMode(false);
+
+    // Worst single service() step of each async operation
+    CAP129nAsync async(cap);
+    MockBusStats worst;
+    byte config[3] = {0x2F, 0x20, 0xFF};
+    dev->setTouched(0x01);
+    async.poll();
+    uint16_t written = async.write(SENSITIVITY_CONTROL, config, sizeof(config));
+    uint16_t calibrated = async.calibrate(0xFF);
+    CHECK(async.poll() == ASYNC_QUEUE_FULL);
+    CHECK(!async.isDone(ASYNC_QUEUE_FULL) && async.status(ASYNC_QUEUE_FULL) == ASYNC_REJECTED);
+    memset(&worst, 0, sizeof(worst));
+    while (!async.isIdle())
+    {
+        Wire.resetStats();
+        async.service();
+        if (Wire.stats.busMicros > worst.busMicros)
+            worst = Wire.stats;
+        mockAdvanceMicros(1000);
+    }
+    report("async service() worst step", worst);
+    expectCount("async service() worst step", worst.transactions, 1, __LINE__);
+    CHECK(async.isDone(calibrated) && async.status(written) == I2C_SUCCESS && async.status(calibrated) == I2C_SUCCESS);
+
+    // A failed step is retried on later calls, one attempt each
+    int reported = ASYNC_PENDING;
+    calibrated = async.calibrate(0x01, asyncDone, &reported);
+    Wire.injectFaults(2);
+    Wire.resetStats();
+    async.service();
+    async.service();
+    CHECK(Wire.stats.transactions == 2 && async.status(calibrated) == ASYNC_PENDING);
+    serviceAsync(async, 1000);
+    CHECK(reported == I2C_SUCCESS && async.status(calibrated) == I2C_SUCCESS);
+
+    // A calibration whose start fails every attempt ends there, with the error
+    calibrated = async.calibrate(0x01, asyncDone, &reported);
+    CHECK(async.status(calibrated) == ASYNC_PENDING);
+    Wire.injectFaults(3);
+    CHECK(serviceAsync(async, 1000) == 3);
+    CHECK(async.isDone(calibrated));
+    CHECK(reported == ERR_I2C_NACK && async.status(calibrated) == ERR_I2C_NACK);
+    CHECK(dev->regs[SENSITIVITY_CONTROL] == 0x2F && dev->regs[CONFIG] == 0x20 && dev->regs[SENSOR_INPUT_ENABLE] == 0xFF);
+
+    // So does one whose status can no longer be read, or whose bits never clear
+    calibrated = async.calibrate(0x01, asyncDone, &reported);
+    uint16_t queued = async.poll();
+    async.service();
+    Wire.injectFaults(3);
+    serviceAsync(async, 1000);
+    CHECK(async.status(calibrated) == ERR_I2C_NACK && async.status(queued) == I2C_SUCCESS);
+    dev->regs[CALIBRATION_ACTIVATE_AND_STATUS] = 0x01;
+    unsigned long start = micros();
+    calibrated = async.calibrate(0x01, asyncDone, &reported);
+    serviceAsync(async, 1000);
+    CHECK(reported == ASYNC_TIMEOUT && micros() - start >= CAP129N_ASYNC_CAL_TIMEOUT_US);
+    dev->regs[CALIBRATION_ACTIVATE_AND_STATUS] = 0x00;
+
+    // A profile, one burst per call
+    cap.resync();
+    static constexpr CAP129nConfig quiet = CAP129nConfig().withThresholds(0x50).withStandbyThreshold(0x30);
+    uint16_t applied = async.apply(quiet, false, asyncDone, &reported);
+    unsigned long bursts = serviceAsync(async, 1000);
+    printf("%-32s %6lu\n", "async apply(profile) bursts", bursts);
+    CHECK(bursts == 3);	//One per block, the configuration block was changed from the defaults above
+    CHECK(async.status(applied) == I2C_SUCCESS && dev->regs[SENSOR_8_INPUT_THRESH] == 0x50 && dev->regs[STANDBY_THRESH] == 0x30);
+    CHECK(cap.apply(quiet) == 0);
+    cap.invalidate();
+    dev->regs[0x25] = 0x5A;
+    async.apply(quiet, true);
+    CHECK(serviceAsync(async, 1000) == 5);	//Configuration block split around its reserved registers
+    CHECK(dev->regs[0x25] == 0x5A && cap.apply(quiet) == 0);
+    cap.resync();
+    dev->setTouched(0x00);
+    cap.poll();
+
+    CAP129nLogger logger(cap, 1000);
+    dev->setDeltaCount(1, 12);
+    BENCH("logger sample()", 1, logger.sample());
+    BENCH("logger sample() again", 1, logger.sample());
+    CountingPrint out;
+    CHECK(logger.flush(out, 4) == 4 && logger.framesBuffered() == 2);
+    CHECK(logger.flush(out) == 2 * CAP129N_FRAME_SIZE - 4 && out.count == 2 * CAP129N_FRAME_SIZE);
+    CHECK(logger.framesBuffered() == 0);
+    for (uint8_t i = 0; i < CAP129N_LOGGER_FRAMES; i++)
+    {
+        mockAdvanceMicros(1000);
+        CHECK(logger.sample());
+    }
+    mockAdvanceMicros(1000);
+    CHECK(!logger.sample() && logger.getDroppedFrames() == 1 && logger.framesBuffered() == CAP129N_LOGGER_FRAMES);
+    logger.flush(out);
+
+    BENCH("enterStandby", 2, cap.enterStandby(0x01, SENSITIVITY_64X));
+    CHECK(cap.getPowerState() == POWER_STANDBY && dev->regs[STANDBY_CHANNEL] == 0x01);
+    BENCH("enterStandby unchanged", 1, cap.enterStandby(0x01, SENSITIVITY_64X));
+    BENCH("wake", 1, cap.wake());
+    BENCH("enterDeepSleep", 1, cap.enterDeepSleep());
+    CHECK(cap.getPowerState() == POWER_DEEP_SLEEP);
+    BENCH("wake from deep sleep", 1, cap.wake());
+    CHECK(cap.getPowerState() == POWER_ACTIVE && (dev->regs[MAIN_CONTROL] & (MAIN_CONTROL_STBY_MASK | MAIN_CONTROL_DSLEEP_MASK)) == 0);
+
+    BENCH("setPowerButton", 1, cap.setPowerButton(1, POWER_BUTTON_TIME_560, POWER_BUTTON_TIME_2240));
+    CHECK(cap.getPowerButton() == 1);
+
+    cap.resetTransferStats();
+    Wire.injectFaults(1);
+    BENCH("poll() one NACK, retried", 2, cap.poll());
+    CHECK(cap.getLastError() == I2C_SUCCESS);
+    Wire.injectFaults(1, true);
+    BENCH("poll() one short read, retried", 2, cap.poll());
+    CHECK(cap.getLastError() == I2C_SUCCESS);
+    const CAP129nTransferStats &transfers = cap.getTransferStats();
+    CHECK(transfers.retries == 2 && transfers.nacks == 1 && transfers.shortReads == 1 && transfers.failures == 0);
+    cap.resetTransferStats();
+
+    dev->setDeltaCount(channels, -5);
+    BENCH("readDeltaCounts", 1, result = cap.readDeltaCounts(deltas));
+    CHECK(result == channels && deltas[0] == 12 && deltas[channels - 1] == -5);
+    BENCH("readBaseCounts", 1, result = cap.readBaseCounts(bases));
+    CHECK(result == channels);
+}
+
+static void benchBus()
+{
+    CAP129n caps[] = {CAP129n(MODEL_CAP1298), CAP129n(MODEL_CAP1298), CAP129n(MODEL_CAP1296), CAP129n(MODEL_CAP1296)};
+    CAP129nBus bus;
+    TouchEvent event;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        Wire.attachDevice(0x28 + i, i < 2 ? MODEL_CAP1298 : MODEL_CAP1296);
+        caps[i].begin(Wire, 0x28 + i);
+        bus.addDevice(caps[i]);
+    }
+    bus.service();
+
+    printf("\nCAP129nBus, 4 devices\n");
+    printf("%-32s %6s %6s %8s\n", "call", "trans", "bytes", "bus_us");
+    BENCH("service() idle pass", 4, bus.service());
+    Wire.device(0x2A)->setTouched(0x02);
+    BENCH("service() one touched", 5, bus.service());
+    CHECK(bus.readEvent(event) && event.device == 2 && event.channel == 2 && event.type == TOUCH_EVENT_PRESS);
+    CHECK(!bus.readEvent(event));
+    CHECK(bus.calibrateAll() && !bus.calibrateAll());
+    BENCH("service() with calibration", 5, bus.service());
+    uint8_t passes = 1;
+    while (bus.isBusy())
+    {
+        bus.service();
+        passes++;
+    }
+    CHECK(passes == 4);	//One device per pass
+}
+
+// Compile-time model, per-channel calls with constant masks
+static void benchTemplate()
+{
+    CAP129nModel<MODEL_CAP1296, 0x2C> cap;
+    MockCAP129n *dev = Wire.attachDevice(0x2C, MODEL_CAP1296);
+    static_assert(CAP129nModel<MODEL_CAP1296>::CHANNELS == 6, "CAP1296 has 6 inputs");
+
+    printf("\nCAP129nModel<MODEL_CAP1296, 0x2C>\n");
+    printf("%-32s %6s %6s %8s\n", "call", "trans", "bytes", "bus_us");
+    BENCH("begin()", 11, CHECK(cap.begin() == BEGIN_SUCCESS));
+    CHECK(cap.begin(Wire, 0x2D) == ERR_NO_DEVICE_AT_ADDRESS);	//Second argument is the address, as on CAP129n
+    CHECK(cap.begin(Wire, 0x2C, SENSITIVITY_16X) == BEGIN_SUCCESS && cap.getSensitivity() == 16);
+    BENCH("disableSensing<4>()", 1, cap.disableSensing<4>());
+    CHECK(!cap.isEnabledSensing<4>() && dev->regs[SENSOR_INPUT_ENABLE] == 0xF7);
+    BENCH("enableSensing(4) runtime id", 1, cap.enableSensing(4));	//Base overloads are not hidden by the templates
+    CHECK(cap.isEnabledSensing(4) && cap.isEnabledSensing<4>());
+    cap.disableSensing(5);
+    CHECK(dev->regs[SENSOR_INPUT_ENABLE] == 0xEF);
+    BENCH("calibrateTouch(1) runtime id", 1, cap.calibrateTouch(1));
+    BENCH("calibrateAll()", 1, cap.calibrateAll());
+    dev->setTouched(0x20);
+    BENCH("isTouched<6>()", 2, CHECK(cap.isTouched<6>()));
+    dev->setTouched(0x00);
+}
+
+// A failed read never leaks into a later, unrelated write or into the caller's buffer
+static void benchErrors()
+{
+    CAP129n cap(MODEL_CAP1298);
+    MockCAP129n *dev = Wire.attachDevice(DEFAULT_I2C_ADDR, MODEL_CAP1298);
+    int8_t deltas[8];
+    cap.begin(Wire);
+
+    printf("\nFailed transfers, every attempt faulted\n");
+    printf("%-32s %6s %6s %8s\n", "call", "trans", "bytes", "bus_us");
+    cap.invalidate();
+    Wire.injectFaults(3);
+    BENCH("getSensingMask() failed", 3, cap.getSensingMask());
+    CHECK(cap.getLastError() == ERR_I2C_NACK);
+    BENCH("setSensingMask() after it", 1, cap.setSensingMask(0x0F));
+    CHECK(cap.getLastError() == I2C_SUCCESS && dev->regs[SENSOR_INPUT_ENABLE] == 0x0F);
+
+    cap.invalidate();
+    Wire.injectFaults(3);
+    BENCH("enableSMBusTimeout() failed read", 3, cap.enableSMBusTimeout());
+    CHECK(cap.getLastError() == ERR_I2C_SKIPPED && dev->regs[CONFIG] == 0x20);
+    BENCH("enableSMBusTimeout() again", 2, cap.enableSMBusTimeout());
+    CHECK(cap.getLastError() == I2C_SUCCESS && dev->regs[CONFIG] == 0xA0);
+
+    // An earlier failure is not mistaken for a failed read of a cached register
+    cap.resync();
+    Wire.injectFaults(3);
+    BENCH("poll() failed", 3, cap.poll());
+    CHECK(cap.getLastError() == ERR_I2C_NACK);
+    BENCH("disableSMBusTimeout() cached", 1, cap.disableSMBusTimeout());
+    CHECK(cap.getLastError() == I2C_SUCCESS && dev->regs[CONFIG] == 0x20);
+    Wire.injectFaults(3);
+    BENCH("getCalibratingMask() failed", 3, cap.getCalibratingMask());
+    BENCH("disableSensing(3) cached", 1, cap.disableSensing(3));
+    CHECK(cap.getLastError() == I2C_SUCCESS && dev->regs[SENSOR_INPUT_ENABLE] == 0x0B);
+
+    memset(deltas, 0x55, sizeof(deltas));
+    dev->setDeltaCount(1, 20);
+    Wire.injectFaults(3);
+    BENCH("readDeltaCounts() failed", 3, CHECK(cap.readDeltaCounts(deltas) == 0));
+    CHECK(deltas[0] == 0x55 && deltas[7] == 0x55);
+
+    uint8_t thresholds[8];
+    uint8_t noiseThreshold = 0x55;
+    memset(thresholds, 0x55, sizeof(thresholds));
+    Wire.injectFaults(3);
+    BENCH("readThresholds() failed", 3, CHECK(cap.readThresholds(thresholds, noiseThreshold) == ERR_I2C_NACK));
+    CHECK(thresholds[0] == 0x55 && thresholds[7] == 0x55 && noiseThreshold == 0x55);
+}
+
+// Bus cost of 10 s with one 200 ms touch after 1 s, fixed 10 ms polling against the scheduler
+static void benchScheduler()
+{
+    CAP129n cap(MODEL_CAP1298);
+    MockCAP129n *dev = Wire.attachDevice(DEFAULT_I2C_ADDR, MODEL_CAP1298);
+    TouchEvent event;
+    cap.begin(Wire);
+
+    printf("\n10 s, one touch\n");
+    printf("%-32s %6s %6s %8s\n", "policy", "trans", "bytes", "bus_us");
+
+    unsigned long transactions[3];
+    for (int mode = 0; mode < 3; mode++)
+    {
+        CAP129nScheduler scheduler(cap);
+        unsigned long events = 0;
+        if (mode == 0)
+            scheduler.setPolicy(10000, 10000, 0, 0);
+        scheduler.setAlertWake(mode == 2);
+        unsigned long start = micros();
+        uint8_t current = 0x00;
+        Wire.resetStats();
+        while (micros() - start < 10000000UL)
+        {
+            unsigned long t = micros() - start;
+            uint8_t touched = (t >= 1000000UL && t < 1200000UL) ? 0x01 : 0x00;
+            if (touched != current)
+            {
+                current = touched;
+                dev->setTouched(touched);
+                cap.handleAlert();
+            }
+            scheduler.service();
+            while (cap.readEvent(event))
+                events++;
+            mockAdvanceMicros(100);
+        }
+        report(mode == 0 ? "fixed 10 ms" : (mode == 1 ? "adaptive" : "adaptive + ALERT wake"), Wire.stats);
+        transactions[mode] = Wire.stats.transactions;
+        CHECK(events == 2);	//One press, one release
+        if (mode == 0)
+            CHECK(scheduler.getPollRate() >= 99 && scheduler.getPollRate() <= 100);	//10 ms apart plus the bus time
+        scheduler.setAlertWake(false);
+    }
+    CHECK(transactions[1] * 4 < transactions[0]);
+    CHECK(transactions[2] < transactions[1]);
+}
+
+/*
+ *	Fake i2c-dev: I2C_RDWR messages go straight to the emulated register
+ *	files behind the mock Wire, a write message sets the register pointer
+ *	and writes the rest, a read message reads from the pointer. While
+ *	"fakeIoctlFaults" is set an ioctl fills the read buffers with garbage
+ *	and fails halfway, like an adapter losing arbitration. With
+ *	"fakeNoZeroLength" zero length messages are refused, like an SMBus-only
+ *	adapter.
+ */
+#define FAKE_FD 3
+
+static uint8_t fakeIoctlFaults = 0;
+static bool fakeNoZeroLength = false;
+
+static int fakeIoctl(int fd, unsigned long request, void *arg)
+{
+    struct i2c_rdwr_ioctl_data *data = (struct i2c_rdwr_ioctl_data *)arg;
+    if (fd != FAKE_FD)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (request != I2C_RDWR)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (fakeIoctlFaults)
+    {
+        fakeIoctlFaults--;
+        for (unsigned i = 0; i < data->nmsgs; i++)
+            if (data->msgs[i].flags & I2C_M_RD)
+                memset(data->msgs[i].buf, 0xEE, data->msgs[i].len);
+        errno = EAGAIN;
+        return -1;
+    }
+    for (unsigned i = 0; i < data->nmsgs; i++)
+    {
+        struct i2c_msg *msg = &data->msgs[i];
+        MockCAP129n *dev = Wire.device(msg->addr);
+        if (fakeNoZeroLength && msg->len == 0)
+        {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+        if (dev == NULL)
+        {
+            errno = ENXIO;
+            return -1;
+        }
+        if (msg->flags & I2C_M_RD)
+        {
+            for (int j = 0; j < msg->len; j++)
+                msg->buf[j] = dev->readNext();
+        }
+        else if (msg->len > 0)
+        {
+            dev->setPointer(msg->buf[0]);
+            for (int j = 1; j < msg->len; j++)
+                dev->writeNext(msg->buf[j]);
+        }
+    }
+    return data->nmsgs;
+}
+
+#define BENCH_IOCTL(name, expected, call) \
+    do                                    \
+    {                                     \
+        transport.resetIoctlCount();      \
+        call;                             \
+        printf("%-32s %6lu\n", name, transport.getIoctlCount()); \
+        expectCount(name, transport.getIoctlCount(), expected, __LINE__); \
+    } while (0)
+
+// Syscalls per call over i2c-dev, Wire-style write() then read() would take two per register read
+static void benchLinux()
+{
+    CAP129n cap(MODEL_CAP1298);
+    MockCAP129n *dev = Wire.attachDevice(DEFAULT_I2C_ADDR, MODEL_CAP1298);
+    CAP129nLinuxTransport transport(FAKE_FD, fakeIoctl);
+    int8_t deltas[8];
+    uint8_t thresholds[8];
+    uint8_t noiseThreshold;
+
+    printf("\nCAP1298 over i2c-dev (fake fd)\n");
+    printf("%-32s %6s\n", "call", "ioctls");
+    BENCH_IOCTL("begin", 11, CHECK(cap.begin(transport) == BEGIN_SUCCESS));
+    BENCH_IOCTL("poll() idle", 1, CHECK(cap.poll().inputStatus == 0x00));
+    dev->setTouched(0x01);
+    dev->setDeltaCount(1, 40);
+    BENCH_IOCTL("poll() touched", 2, CHECK(cap.poll().inputStatus == 0x01));
+    BENCH_IOCTL("poll(deltas) batched", 1, cap.poll(deltas));
+    printf("%-32s %6d\n", "  delta 1", deltas[0]);
+    CHECK(deltas[0] == 40 && cap.getLastError() == I2C_SUCCESS);
+    BENCH_IOCTL("readThresholds", 1, cap.readThresholds(thresholds, noiseThreshold));
+    CHECK(thresholds[0] == dev->regs[SENSOR_1_INPUT_THRESH]);
+    fakeIoctlFaults = 3;
+    BENCH_IOCTL("poll(deltas) failed", 3, cap.poll(deltas));
+    CHECK(cap.getLastError() == ERR_I2C_BUS && deltas[0] == 40);
+    dev->setTouched(0x00);
+
+    fakeNoZeroLength = true;
+    BENCH_IOCTL("begin, no zero length writes", 12, CHECK(cap.begin(transport) == BEGIN_SUCCESS));
+    BENCH_IOCTL("begin, no device", 10, CHECK(cap.begin(transport, 0x50) == ERR_NO_DEVICE_AT_ADDRESS));	//Five probes of two ioctls
+    fakeNoZeroLength = false;
+}
+
+// Guided tune of a CAP1296 at 32x, noise up to 3 counts, touches of about 36/24/12 counts on inputs 1..3
+static void benchTune()
+{
+    CAP129n cap(MODEL_CAP1296);
+    MockCAP129n *dev = Wire.attachDevice(DEFAULT_I2C_ADDR, MODEL_CAP1296);
+    CAP129nTuner tuner(SENSITIVITY_32X);
+    static const int8_t touch[3] = {36, 24, 12};
+    cap.begin(Wire);
+
+    printf("\nGuided tune, CAP1296 captured at 32x\n");
+    Wire.resetStats();
+    tuner.beginIdle();
+    for (int n = 0; n < 64; n++)
+    {
+        for (uint8_t id = 1; id <= 6; id++)
+            dev->setDeltaCount(id, (int8_t)((n * 5 + id * 3) % 7 - 3));
+        tuner.update(cap);
+    }
+    for (uint8_t id = 1; id <= 3; id++)
+    {
+        tuner.beginTouch(id);
+        for (int n = 0; n < 32; n++)
+        {
+            dev->setDeltaCount(id, n < 4 ? 1 : touch[id - 1] + (n % 5) - 2);	//Finger lands after a few samples
+            tuner.update(cap);
+        }
+        dev->setDeltaCount(id, 0);
+    }
+    tuner.endPhase();
+    report("capture, 160 samples", Wire.stats);
+
+    bool solved = tuner.solve();
+    printf("%-32s %s %u\n", "solve() sensitivity code", solved ? "ok" : "failed", tuner.getSensitivity());
+    for (uint8_t id = 1; id <= 3; id++)
+        printf("  input %u noise %u signal %u snr x10 %u threshold %u\n", id, tuner.getNoisePeak(id), tuner.getSignal(id), tuner.getSNR(id), tuner.getThreshold(id));
+    CHECK(solved && tuner.getSensitivity() == SENSITIVITY_128X && tuner.getTunedMask() == 0x07);
+    for (uint8_t id = 1; id <= 3; id++)
+        CHECK(tuner.getThreshold(id) > tuner.getNoisePeak(id) * 4 && tuner.getThreshold(id) * 100 <= tuner.getSignal(id) * 4 * TUNE_DETECT_PERCENT);
+    CAP129nConfig tuned = tuner.getConfig();
+    BENCH("apply(tuned)", 2, cap.apply(tuned));
+    CHECK(cap.getThreshold(3) == tuner.getThreshold(3));
+}
+
+/*
+ *	Scripted gesture sequences on the mock clock with the default timings
+ *	(tap 250 ms, double-tap gap 300 ms, long press 800 ms, repeat 200 ms).
+ *	The status is sampled every 10 ms, a step sets it from its time on.
+ */
+struct GestureStep
+{
+    unsigned long ms;
+    uint8_t status;
+};
+
+struct GestureExpect
+{
+    uint8_t channel;
+    uint8_t type;
+    unsigned long ms;	//Event timestamp since the start of the script
+};
+
+static void expectGestures(const char *name, const GestureStep *steps, uint8_t stepCount, unsigned long endMs,
+                           const GestureExpect *expected, uint8_t expectedCount)
+{
+    CAP129nGestures gestures;
+    TouchEvent event;
+    uint8_t status = 0x00;
+    uint8_t step = 0;
+    uint8_t seen = 0;
+    bool match = true;
+    unsigned long start = micros();
+    for (unsigned long t = 0; t <= endMs; t += 10)
+    {
+        while (step < stepCount && steps[step].ms <= t)
+            status = steps[step++].status;
+        gestures.update(status);
+        while (gestures.readEvent(event))
+        {
+            unsigned long ms = (event.timestamp - start) / 1000;
+            if (seen >= expectedCount || event.channel != expected[seen].channel ||
+                event.type != expected[seen].type || ms != expected[seen].ms)
+            {
+                printf("  %s: unexpected event %u channel %u at %lu ms\n", name, event.type, event.channel, ms);
+                match = false;
+            }
+            seen++;
+        }
+        mockAdvanceMicros(10000);
+    }
+    checks++;
+    if (match && seen == expectedCount)
+        return;
+    failures++;
+    printf("FAIL %s:%d: gestures \"%s\" did not match, %u events, expected %u\n", __FILE__, __LINE__, name, seen, expectedCount);
+}
+
+#define EXPECT_GESTURES(name, steps, endMs, expected) \
+    expectGestures(name, steps, sizeof(steps) / sizeof(steps[0]), endMs, expected, sizeof(expected) / sizeof(expected[0]))
+
+static void benchGestures()
+{
+    static const GestureStep tap[] = {{10, 0x01}, {100, 0x00}};
+    static const GestureExpect tapEvents[] = {{1, TOUCH_EVENT_TAP, 100}};
+    EXPECT_GESTURES("tap", tap, 600, tapEvents);
+
+    // Second press 280 ms after the first release, second release 500 ms after it
+    static const GestureStep doubleTap[] = {{10, 0x02}, {100, 0x00}, {380, 0x02}, {600, 0x00}};
+    static const GestureExpect doubleTapEvents[] = {{2, TOUCH_EVENT_DOUBLE_TAP, 600}};
+    EXPECT_GESTURES("double tap", doubleTap, 1200, doubleTapEvents);
+
+    static const GestureStep hold[] = {{10, 0x04}, {1300, 0x00}};
+    static const GestureExpect holdEvents[] = {{3, TOUCH_EVENT_LONG_PRESS, 810}, {3, TOUCH_EVENT_HOLD_REPEAT, 1010}, {3, TOUCH_EVENT_HOLD_REPEAT, 1210}};
+    EXPECT_GESTURES("hold, release", hold, 2000, holdEvents);
+
+    static const GestureStep slow[] = {{10, 0x01}, {400, 0x00}};
+    static const GestureExpect slowEvents[1] = {};
+    expectGestures("slow release", slow, 2, 1000, slowEvents, 0);
+
+    static const GestureStep gap[] = {{10, 0x01}, {100, 0x00}, {450, 0x01}, {500, 0x00}};
+    static const GestureExpect gapEvents[] = {{1, TOUCH_EVENT_TAP, 100}, {1, TOUCH_EVENT_TAP, 500}};
+    EXPECT_GESTURES("gap exceeded", gap, 1000, gapEvents);
+
+    static const GestureStep both[] = {{10, 0x09}, {100, 0x00}};
+    static const GestureExpect bothEvents[] = {{1, TOUCH_EVENT_TAP, 100}, {4, TOUCH_EVENT_TAP, 100}};
+    EXPECT_GESTURES("simultaneous taps", both, 600, bothEvents);
+
+    static const GestureStep tapThenHold[] = {{10, 0x01}, {100, 0x00}, {200, 0x01}, {1100, 0x00}};
+    static const GestureExpect tapThenHoldEvents[] = {{1, TOUCH_EVENT_TAP, 100}, {1, TOUCH_EVENT_LONG_PRESS, 1000}};
+    EXPECT_GESTURES("tap, then long press", tapThenHold, 1500, tapThenHoldEvents);
+}
+
+static void countCall(uint8_t channel, uint8_t type, void *context)
+{
+    (void)channel;
+    (void)type;
+    (*(int *)context)++;
+}
+
+// Once, replaces the handler in "handle" with one counting into "fresh", which takes the same slot
+struct SwapContext
+{
+    CAP129nDispatcher *dispatcher;
+    int8_t handle;
+    int fresh;
+    bool swapped;
+};
+
+static void swapCall(uint8_t channel, uint8_t type, void *context)
+{
+    (void)channel;
+    SwapContext *swap = (SwapContext *)context;
+    if (swap->swapped)
+        return;
+    swap->swapped = true;
+    swap->dispatcher->off(swap->handle);
+    swap->handle = swap->dispatcher->on(0x01, type, countCall, &swap->fresh);
+}
+
+// Registration errors, press/release/hold routing and a table change from inside a handler
+static void benchDispatch()
+{
+    CAP129nDispatcher dispatcher;
+    int presses = 0, releases = 0, holds = 0;
+    CHECK(dispatcher.onChannel(9, TOUCH_EVENT_PRESS, countCall, &presses) == ERR_DISPATCH_INVALID);
+    CHECK(dispatcher.on(0x01, TOUCH_EVENT_PRESS, NULL) == ERR_DISPATCH_INVALID);
+    CHECK(dispatcher.on(0x00, TOUCH_EVENT_PRESS, countCall, &presses) == ERR_DISPATCH_INVALID);
+    CHECK(dispatcher.on(0x01, TOUCH_EVENT_TAP, countCall, &presses) == ERR_DISPATCH_INVALID);
+    for (int8_t i = 0; i < CAP129N_DISPATCH_HANDLERS; i++)
+        CHECK(dispatcher.on(0x01, TOUCH_EVENT_PRESS, countCall, &presses) == i);
+    CHECK(dispatcher.on(0x01, TOUCH_EVENT_PRESS, countCall, &presses) == ERR_DISPATCH_FULL);
+    for (int8_t i = 0; i < CAP129N_DISPATCH_HANDLERS; i++)
+        dispatcher.off(i);
+
+    dispatcher.on(0xFF, TOUCH_EVENT_PRESS, countCall, &presses);
+    dispatcher.on(0x03, TOUCH_EVENT_RELEASE, countCall, &releases);
+    dispatcher.onChannel(2, TOUCH_EVENT_LONG_PRESS, countCall, &holds);
+    CHECK(dispatcher.update(0x03, 0) == 2 && presses == 2);
+    CHECK(dispatcher.update(0x01, 100000UL) == 1 && releases == 1);
+    CHECK(dispatcher.update(0x03, 200000UL) == 1 && presses == 3);
+    CHECK(dispatcher.update(0x03, 990000UL) == 0 && holds == 0);
+    CHECK(dispatcher.update(0x03, 1000000UL) == 1 && holds == 1);
+    CHECK(dispatcher.update(0x03, 1100000UL) == 0 && holds == 1);
+    CHECK(dispatcher.update(0x00, 1200000UL) == 2 && releases == 3);
+
+    CAP129nDispatcher reentrant;
+    int old = 0;
+    SwapContext swap = {&reentrant, 0, 0, false};
+    CHECK(reentrant.on(0x01, TOUCH_EVENT_PRESS, swapCall, &swap) == 0);
+    swap.handle = reentrant.on(0x01, TOUCH_EVENT_PRESS, countCall, &old);
+    CHECK(reentrant.update(0x01, 0) == 1);
+    CHECK(swap.handle == 1 && old == 0 && swap.fresh == 0);
+    reentrant.update(0x00, 10000UL);
+    CHECK(reentrant.update(0x01, 20000UL) == 2 && swap.fresh == 1 && old == 0);
+}
+
+// Slider and wheel positions from known delta vectors
+static void benchSlider()
+{
+    static const uint8_t row[4] = {1, 2, 3, 4};
+    static const uint8_t ring[3] = {1, 2, 3};
+    CAP129nSlider slider;
+    CHECK(slider.setChannels(row, 4));
+    CHECK(slider.getRange() == 3 * CAP129N_SLIDER_RESOLUTION + 1);
+
+    static const int8_t between[8] = {0, 20, 20, 0};
+    CHECK(slider.update(between, 1000000UL) && slider.getPosition() == 384);
+    static const int8_t leaning[8] = {10, 30, 0, 0};
+    CHECK(slider.update(leaning, 1010000UL) && slider.getPosition() == 192);
+    CHECK(slider.getVelocity() == -19200);
+
+    // End segments have no outer neighbour
+    static const int8_t first[8] = {30, 10, 0, 0};
+    CHECK(slider.update(first) && slider.getPosition() == 64);
+    static const int8_t firstOnly[8] = {30, 0, 0, 0};
+    CHECK(slider.update(firstOnly) && slider.getPosition() == 0);
+    static const int8_t last[8] = {0, 0, 10, 30};
+    CHECK(slider.update(last) && slider.getPosition() == 704);
+    static const int8_t lastOnly[8] = {0, 0, 0, 30};
+    CHECK(slider.update(lastOnly) && slider.getPosition() == slider.getRange() - 1);
+
+    // One active pad, negative neighbours count as 0
+    static const int8_t single[8] = {-5, 25, -3, 0};
+    CHECK(slider.update(single) && slider.getPosition() == 256);
+
+    // All below the touch delta keeps the last position
+    static const int8_t idle[8] = {9, 9, 9, 9, 40, 40, 40, 40};
+    CHECK(!slider.update(idle) && !slider.isTouched() && slider.getVelocity() == 0);
+    CHECK(slider.getPosition() == 256);
+
+    // A wheel wraps the left neighbour of the first pad
+    CHECK(slider.setChannels(ring, 3, true));
+    CHECK(slider.getRange() == 3 * CAP129N_SLIDER_RESOLUTION);
+    static const int8_t wrapped[8] = {20, 0, 20};
+    CHECK(slider.update(wrapped, 2000000UL) && slider.getPosition() == 640);
+    static const int8_t across[8] = {30, 10, 0};
+    CHECK(slider.update(across, 2010000UL) && slider.getPosition() == 64);
+    CHECK(slider.getVelocity() == 19200);	//The short way round, 192 steps in 10 ms
+
+    CAP129n cap(MODEL_CAP1298);
+    MockCAP129n *dev = Wire.attachDevice(DEFAULT_I2C_ADDR, MODEL_CAP1298);
+    cap.begin(Wire);
+    printf("\nSlider, CAP1298\n");
+    CHECK(slider.setChannels(row, 4));
+    dev->setDeltaCount(3, 30);
+    BENCH("slider update(device)", 1, CHECK(slider.update(cap) && slider.getPosition() == 512));
+    Wire.injectFaults(3);
+    BENCH("slider update(device) failed", 3, CHECK(!slider.update(cap) && slider.getPosition() == 512));
+    dev->setDeltaCount(3, 0);
+}
+
+#if CAP129N_INSTRUMENTATION
+class StdoutPrint : public Print
+{
+public:
+    size_t write(uint8_t data) { return fputc(data, stdout) == EOF ? 0 : 1; }
+};
+
+// ALERT to event latency of 100 touches, serviced 0..9 ms after the ISR
+static void benchLatency()
+{
+    CAP129n cap(MODEL_CAP1298);
+    MockCAP129n *dev = Wire.attachDevice(DEFAULT_I2C_ADDR, MODEL_CAP1298);
+    TouchEvent event;
+    StdoutPrint out;
+    CAP129nStats stats;
+    cap.begin(Wire);
+    CHECK(cap.getLatencyStats(stats) && stats.get(STAT_OP_BEGIN).count == 1);
+    cap.setAlertMode(true);
+    cap.service();
+    cap.resetLatencyStats();
+
+    for (int i = 0; i < 200; i++)
+    {
+        dev->setTouched(i & 1 ? 0x00 : 0x01);
+        cap.handleAlert();
+        mockAdvanceMicros((i * 7919UL) % 10000);
+        cap.service();
+        mockAdvanceMicros(50000);
+        cap.service();	//Status latches, the next poll picks up the current state
+        while (cap.readEvent(event))
+            ;
+    }
+    CHECK(cap.getLatencyStats(stats));
+    printf("\nLatency, 100 touches (op count max_us p50_us p99_us)\n");
+    stats.dump(out);
+    CHECK(stats.get(STAT_OP_ALERT_TO_EVENT).count == 100);
+    CHECK(stats.get(STAT_OP_ALERT_TO_EVENT).max < 11000);	//Serviced within 10 ms, plus the bus time
+}
+#endif
+
+int main()
+{
+    Wire.setClock(100000);
+    printf("CAP129n I2C cost per call at 100 kHz\n");
+    benchModel("CAP1293", MODEL_CAP1293);
+    benchModel("CAP1296", MODEL_CAP1296);
+    benchModel("CAP1298", MODEL_CAP1298);
+    benchBus();
+    benchTemplate();
+    benchErrors();
+    benchScheduler();
+    benchLinux();
+    benchTune();
+    benchGestures();
+    benchSlider();
+    benchDispatch();
+#if CAP129N_INSTRUMENTATION
+    benchLatency();
+#endif
+
+    printf("\n%lu checks, %lu failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *	Turns a binary capture of CAP129nLogger frames into CSV.
+ *
+ *	cap129n_decode capture.bin > capture.csv
+ *	cat /dev/ttyACM0 | cap129n_decode > capture.csv
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "CAP129n_logger.h"
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    if (argc > 1)
+    {
+        in = fopen(argv[1], "rb");
+        if (in == NULL)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    printf("sequence,timestamp_us,general_status,input_status,noise_flags,delta_1,delta_2,delta_3,delta_4,delta_5,delta_6,delta_7,delta_8\n");
+
+    byte window[CAP129N_FRAME_SIZE];
+    size_t filled = 0;
+    unsigned long frames = 0, skipped = 0, lost = 0;
+    long lastSequence = -1;
+    int c;
+    while ((c = fgetc(in)) != EOF)
+    {
+        window[filled++] = (byte)c;
+        if (filled < CAP129N_FRAME_SIZE)
+            continue;
+
+        CAP129nFrame frame;
+        if (!CAP129nLogger::decode(window, frame))
+        {
+            // Resynchronise one byte at a time
+            memmove(window, window + 1, --filled);
+            skipped++;
+            continue;
+        }
+        filled = 0;
+        frames++;
+        if (lastSequence >= 0)
+            lost += (uint16_t)(frame.sequence - lastSequence - 1);
+        lastSequence = frame.sequence;
+
+        printf("%u,%lu,%u,%u,%u", frame.sequence, (unsigned long)frame.timestamp, frame.generalStatus, frame.inputStatus, frame.noiseFlags);
+        for (int i = 0; i < 8; i++)
+            printf(",%d", frame.delta[i]);
+        printf("\n");
+    }
+
+    fprintf(stderr, "%lu frames, %lu lost, %lu bytes skipped\n", frames, lost, skipped);
+    if (in != stdin)
+        fclose(in);
+    return 0;
+}
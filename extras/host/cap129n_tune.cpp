@@ -0,0 +1,126 @@
+/*
+ *	Offline auto-tune from a cap129n_decode CSV. Frames with no input
+ *	touched are the idle samples, frames with an input's status bit set are
+ *	its touch samples. Prints per-input noise, signal and SNR and the
+ *	tuned profile as C++.
+ *
+ *	cap129n_tune [-s capture_sensitivity] [-m noise_margin_%] [-d detect_%] capture.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "CAP129n.h"
+#include "CAP129n_profile.h"
+#include "CAP129n_tune.h"
+
+struct Frame
+{
+    unsigned status;
+    int8_t delta[8];
+};
+
+static const char *sensitivityName(uint8_t sensitivity)
+{
+    static const char *names[] = {"SENSITIVITY_128X", "SENSITIVITY_64X", "SENSITIVITY_32X", "SENSITIVITY_16X",
+                                  "SENSITIVITY_8X", "SENSITIVITY_4X", "SENSITIVITY_2X", "SENSITIVITY_1X"};
+    return sensitivity <= SENSITIVITY_1X ? names[sensitivity] : "?";
+}
+
+// 128, 64, ... 1 to SENSITIVITY_*
+static int sensitivityCode(int multiplier)
+{
+    for (int code = SENSITIVITY_128X; code <= SENSITIVITY_1X; code++)
+        if ((128 >> code) == multiplier)
+            return code;
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    int sensitivity = SENSITIVITY_32X;
+    int margin = TUNE_NOISE_MARGIN_PERCENT;
+    int detect = TUNE_DETECT_PERCENT;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:m:d:")) != -1)
+    {
+        if (opt == 's')
+            sensitivity = sensitivityCode(atoi(optarg));
+        else if (opt == 'm')
+            margin = atoi(optarg);
+        else if (opt == 'd')
+            detect = atoi(optarg);
+        if (opt == '?' || sensitivity < 0)
+        {
+            fprintf(stderr, "usage: %s [-s 128|64|32|16|8|4|2|1] [-m noise_margin_%%] [-d detect_%%] [capture.csv]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    FILE *in = stdin;
+    if (optind < argc)
+    {
+        in = fopen(argv[optind], "r");
+        if (in == NULL)
+        {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+
+    // sequence,timestamp_us,general_status,input_status,noise_flags,delta_1..delta_8
+    std::vector<Frame> frames;
+    char line[256];
+    while (fgets(line, sizeof(line), in))
+    {
+        unsigned sequence, general, status, noise;
+        unsigned long timestamp;
+        int d[8];
+        if (sscanf(line, "%u,%lu,%u,%u,%u,%d,%d,%d,%d,%d,%d,%d,%d", &sequence, &timestamp, &general, &status, &noise,
+                   &d[0], &d[1], &d[2], &d[3], &d[4], &d[5], &d[6], &d[7]) != 13)
+            continue;	//Header or damaged line
+        Frame frame;
+        frame.status = status;
+        for (int i = 0; i < 8; i++)
+            frame.delta[i] = (int8_t)d[i];
+        frames.push_back(frame);
+    }
+    if (in != stdin)
+        fclose(in);
+
+    // Idle first, the touch samples are filtered against the idle noise peak
+    CAP129nTuner tuner(sensitivity);
+    tuner.setMargins(margin, detect);
+    for (size_t f = 0; f < frames.size(); f++)
+        if (frames[f].status == 0)
+            tuner.addIdle(frames[f].delta);
+    for (size_t f = 0; f < frames.size(); f++)
+        for (uint8_t id = 1; id <= 8; id++)
+            if (frames[f].status & (1 << (id - 1)))
+                tuner.addTouch(id, frames[f].delta[id - 1]);
+
+    bool solved = tuner.solve();
+    fprintf(stderr, "%lu frames at %s\n", (unsigned long)frames.size(), sensitivityName(sensitivity));
+    fprintf(stderr, "input idle touch noise_peak signal snr threshold\n");
+    for (uint8_t id = 1; id <= 8; id++)
+    {
+        if (tuner.getIdleSamples(id) == 0 && tuner.getTouchSamples(id) == 0)
+            continue;
+        uint16_t snr = tuner.getSNR(id);
+        fprintf(stderr, "%5u %4lu %5lu %10u %6u %3u.%u %9u\n", id, tuner.getIdleSamples(id), tuner.getTouchSamples(id),
+                tuner.getNoisePeak(id), tuner.getSignal(id), snr / 10, snr % 10, tuner.getThreshold(id));
+    }
+    if (!solved)
+        fprintf(stderr, "no setting keeps the margins, showing %s\n", sensitivityName(tuner.getSensitivity()));
+
+    printf("static constexpr CAP129nConfig tuned = CAP129nConfig()\n");
+    printf("    .withSensitivity(%s)", sensitivityName(tuner.getSensitivity()));
+    for (uint8_t id = 1; id <= 8; id++)
+        if (tuner.getThreshold(id))
+            printf("\n    .withThreshold(%u, 0x%02X)", id, tuner.getThreshold(id));
+    printf(";\n");
+    return solved ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+/*
+ *	Monotonic clock and sleeps for the Linux shim.
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include "Arduino.h"
+
+static uint64_t monotonicMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+static uint64_t startMicros = monotonicMicros();
+
+unsigned long micros()
+{
+    return (unsigned long)(monotonicMicros() - startMicros);
+}
+
+unsigned long millis()
+{
+    return (unsigned long)((monotonicMicros() - startMicros) / 1000);
+}
+
+static void sleepMicros(uint64_t us)
+{
+    struct timespec remaining;
+    remaining.tv_sec = us / 1000000;
+    remaining.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&remaining, &remaining) != 0 && errno == EINTR)
+        ;
+}
+
+void delay(unsigned long ms)
+{
+    sleepMicros((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    sleepMicros(us);
+}
@@ -0,0 +1,61 @@
+/*
+ *	Arduino core shim for running the CAP129n library on Linux. Time comes
+ *	from CLOCK_MONOTONIC, delays sleep the calling thread.
+ */
+
+#ifndef __CAP129n_LINUX_ARDUINO_H__
+#define __CAP129n_LINUX_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+// Since the first call, wrapping like on a microcontroller
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t data) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size-- && write(*buffer++))
+      n++;
+    return n;
+  }
+  virtual int availableForWrite() { return 0; }
+
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(unsigned long n)
+  {
+    char digits[21];
+    char *p = &digits[sizeof(digits) - 1];
+    *p = '\0';
+    do
+    {
+      *--p = '0' + n % 10;
+      n /= 10;
+    } while (n);
+    return print(p);
+  }
+  size_t println() { return print("\r\n"); }
+  size_t println(const char *s) { return print(s) + println(); }
+  size_t println(unsigned long n) { return print(n) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+#endif
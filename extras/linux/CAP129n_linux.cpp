@@ -0,0 +1,167 @@
+/*
+ *	This file contains the Linux i2c-dev implementation of the CAP129n
+ *	transport.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "CAP129n_registers.h"
+#include "CAP129n_linux.h"
+
+static int systemIoctl(int fd, unsigned long request, void *arg)
+{
+    return ioctl(fd, request, arg);
+}
+
+CAP129nLinuxTransport::CAP129nLinuxTransport(int fd, CAP129nIoctl ioctlFunction){
+	_fd = fd;
+	_ownsFd = false;
+	_ioctl = ioctlFunction ? ioctlFunction : systemIoctl;
+	_ioctlCount = 0;
+}
+
+CAP129nLinuxTransport::~CAP129nLinuxTransport(){
+	close();
+}
+
+bool CAP129nLinuxTransport::open(const char *device){
+	close();
+	_fd = ::open(device, O_RDWR);
+	_ownsFd = _fd >= 0;
+	return _fd >= 0;
+}
+
+void CAP129nLinuxTransport::close(){
+	if (_ownsFd)
+		::close(_fd);
+	_fd = -1;
+	_ownsFd = false;
+}
+
+/*
+ *	Register pointer write and data read as one combined transaction, the
+ *	adapter issues a repeated start between the two messages.
+ */
+int CAP129nLinuxTransport::writeRead(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len)
+{
+    CAP129nRead read = {reg, buffer, len};
+    return readBatch(address, &read, 1);
+}
+
+int CAP129nLinuxTransport::write(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len)
+{
+    uint8_t data[CAP129N_LINUX_MAX_WRITE];
+    if (len > sizeof(data) - 1)
+        return ERR_I2C_BUS;
+    data[0] = reg;
+    if (len > 0)
+        memcpy(&data[1], buffer, len);
+
+    struct i2c_msg message = {address, 0, (uint16_t)(len + 1), data};
+    return transfer(&message, 1);
+}
+
+int CAP129nLinuxTransport::burstRead(uint8_t address, uint8_t *buffer, uint8_t len)
+{
+    uint8_t data[CAP129N_LINUX_MAX_READ];
+    struct i2c_msg message = {address, I2C_M_RD, len, data};
+    int result = transfer(&message, 1);
+    if (result == I2C_SUCCESS)
+        memcpy(buffer, data, len);
+    return result;
+}
+
+/*
+ *	Zero length write. Adapters that cannot send one (SMBus-only or
+ *	without I2C_FUNC_PROTOCOL_MANGLING) fail it, a one byte read of
+ *	PROD_ID is tried then.
+ */
+int CAP129nLinuxTransport::probe(uint8_t address)
+{
+    struct i2c_msg message = {address, 0, 0, NULL};
+    if (transfer(&message, 1) == I2C_SUCCESS)
+        return I2C_SUCCESS;
+    uint8_t id;
+    return writeRead(address, PROD_ID, &id, 1);
+}
+
+/*
+ *	One write/read message pair per register read, all in a single
+ *	I2C_RDWR ioctl. The register bytes live in "regs" so the caller's
+ *	requests can stay const. The data is read into "data" and only copied
+ *	to the callers' buffers once the whole ioctl succeeded, a failed or
+ *	partial transfer leaves them untouched.
+ */
+int CAP129nLinuxTransport::readBatch(uint8_t address, const CAP129nRead *reads, uint8_t count)
+{
+    if (count == 0)
+        return I2C_SUCCESS;
+    unsigned total = 0;
+    for (uint8_t i = 0; i < count; i++)
+        total += reads[i].len;
+    if (count > CAP129N_LINUX_MAX_BATCH || total > CAP129N_LINUX_MAX_READ)
+        return CAP129nTransport::readBatch(address, reads, count);
+
+    uint8_t regs[CAP129N_LINUX_MAX_BATCH];
+    uint8_t data[CAP129N_LINUX_MAX_READ];
+    struct i2c_msg messages[2 * CAP129N_LINUX_MAX_BATCH];
+    unsigned offset = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        regs[i] = reads[i].reg;
+        messages[2 * i].addr = address;
+        messages[2 * i].flags = 0;
+        messages[2 * i].len = 1;
+        messages[2 * i].buf = &regs[i];
+        messages[2 * i + 1].addr = address;
+        messages[2 * i + 1].flags = I2C_M_RD;
+        messages[2 * i + 1].len = reads[i].len;
+        messages[2 * i + 1].buf = &data[offset];
+        offset += reads[i].len;
+    }
+    int result = transfer(messages, 2 * count);
+    if (result != I2C_SUCCESS)
+        return result;
+    offset = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        memcpy(reads[i].buffer, &data[offset], reads[i].len);
+        offset += reads[i].len;
+    }
+    return I2C_SUCCESS;
+}
+
+/*
+ *	The ioctl returns the number of messages transferred, or -1 with
+ *	ENXIO/EREMOTEIO when the address or a data byte was not acknowledged.
+ */
+int CAP129nLinuxTransport::transfer(void *messages, uint8_t count)
+{
+    if (_fd < 0)
+        return ERR_I2C_BUS;
+
+    struct i2c_rdwr_ioctl_data data;
+    data.msgs = (struct i2c_msg *)messages;
+    data.nmsgs = count;
+    _ioctlCount++;
+    int result = _ioctl(_fd, I2C_RDWR, &data);
+    if (result == count)
+        return I2C_SUCCESS;
+    if (result >= 0)
+        return ERR_I2C_SHORT_READ;
+    return (errno == ENXIO || errno == EREMOTEIO) ? ERR_I2C_NACK : ERR_I2C_BUS;
+}
+
+unsigned long CAP129nLinuxTransport::getIoctlCount(){
+	return _ioctlCount;
+}
+
+void CAP129nLinuxTransport::resetIoctlCount(){
+	_ioctlCount = 0;
+}
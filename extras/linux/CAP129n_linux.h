@@ -0,0 +1,58 @@
+/*
+ *	Linux i2c-dev transport of the CAP1293/6/8 library. Every register
+ *	read is one I2C_RDWR ioctl carrying a write/read message pair with a
+ *	repeated start, and readBatch() puts several reads into the same
+ *	ioctl. The ioctl can be replaced so the transport runs against a fake
+ *	fd layer without hardware.
+ */
+
+#ifndef __CAP129n_linux_H__
+#define __CAP129n_linux_H__
+
+#include <Arduino.h>
+
+#include "CAP129n_transport.h"
+
+//Reads per readBatch() ioctl, the kernel allows 42 messages
+#define CAP129N_LINUX_MAX_BATCH 8
+//Largest write, register byte included
+#define CAP129N_LINUX_MAX_WRITE 33
+//Bytes per read ioctl, larger batches fall back to one ioctl per read
+#define CAP129N_LINUX_MAX_READ 256
+
+// Same contract as ioctl(2), "request" is always I2C_RDWR
+typedef int (*CAP129nIoctl)(int fd, unsigned long request, void *arg);
+
+class CAP129nLinuxTransport : public CAP129nTransport
+{
+public:
+  CAP129nLinuxTransport(int fd = -1, CAP129nIoctl ioctlFunction = NULL);
+  ~CAP129nLinuxTransport();	//Closes the fd if open() opened it
+
+  // Opens an adapter such as "/dev/i2c-1", returns false if it can not be opened
+  bool open(const char *device);
+  void close();
+
+  int writeRead(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len);
+  int write(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len);
+  int burstRead(uint8_t address, uint8_t *buffer, uint8_t len);
+  int probe(uint8_t address);
+  int readBatch(uint8_t address, const CAP129nRead *reads, uint8_t count);
+
+  // ioctl calls made since the last resetIoctlCount()
+  unsigned long getIoctlCount();
+  void resetIoctlCount();
+
+private:
+  CAP129nLinuxTransport(const CAP129nLinuxTransport &) = delete;
+  CAP129nLinuxTransport &operator=(const CAP129nLinuxTransport &) = delete;
+
+  int transfer(void *messages, uint8_t count);
+
+  int _fd;
+  bool _ownsFd;
+  CAP129nIoctl _ioctl;
+  unsigned long _ioctlCount;
+};
+
+#endif
@@ -0,0 +1,7 @@
+/*
+ *	The global TwoWire of the Linux shim, see Wire.h.
+ */
+
+#include "Wire.h"
+
+TwoWire Wire;
@@ -0,0 +1,29 @@
+/*
+ *	TwoWire placeholder for the Linux shim. The library's TwoWire
+ *	overloads need the type and the global "Wire" to compile, but there is
+ *	no Arduino bus on Linux: every transfer fails as a bus error. Pass a
+ *	CAP129nLinuxTransport to begin() instead.
+ */
+
+#ifndef __CAP129n_LINUX_WIRE_H__
+#define __CAP129n_LINUX_WIRE_H__
+
+#include "Arduino.h"
+
+class TwoWire
+{
+public:
+  void begin() {}
+  void setClock(uint32_t) {}
+
+  void beginTransmission(uint8_t) {}
+  size_t write(uint8_t) { return 0; }
+  uint8_t endTransmission(bool = true) { return 4; }	//Other error
+  uint8_t requestFrom(uint8_t, uint8_t, bool = true) { return 0; }
+  int available() { return 0; }
+  int read() { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ *	Prints the touch events of a CAP1293/6/8 on an i2c-dev adapter,
+ *	polled by the adaptive scheduler on the real clock.
+ *
+ *	cap129n_events [-m 1293|1296|1298] [-a address] [/dev/i2c-1]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+#include "CAP129n.h"
+#include "CAP129n_scheduler.h"
+#include "CAP129n_linux.h"
+
+static const char *eventName(uint8_t type)
+{
+    switch (type)
+    {
+    case TOUCH_EVENT_PRESS:
+        return "press";
+    case TOUCH_EVENT_RELEASE:
+        return "release";
+    case TOUCH_EVENT_TAP:
+        return "tap";
+    case TOUCH_EVENT_DOUBLE_TAP:
+        return "double_tap";
+    case TOUCH_EVENT_LONG_PRESS:
+        return "long_press";
+    case TOUCH_EVENT_HOLD_REPEAT:
+        return "hold_repeat";
+    case TOUCH_EVENT_POWER_BUTTON:
+        return "power_button";
+    default:
+        return "?";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t model = MODEL_CAP1298;
+    uint8_t address = DEFAULT_I2C_ADDR;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:a:")) != -1)
+    {
+        int value = (opt == '?') ? 0 : (int)strtol(optarg, NULL, 0);
+        if (opt == 'm' && (value == 1293 || value == 1296 || value == 1298))
+            model = value == 1293 ? MODEL_CAP1293 : (value == 1296 ? MODEL_CAP1296 : MODEL_CAP1298);
+        else if (opt == 'a' && value > 0 && value < 0x80)
+            address = value;
+        else
+        {
+            fprintf(stderr, "usage: %s [-m 1293|1296|1298] [-a address] [/dev/i2c-N]\n", argv[0]);
+            return 2;
+        }
+    }
+    const char *device = optind < argc ? argv[optind] : "/dev/i2c-1";
+
+    CAP129nLinuxTransport transport;
+    if (!transport.open(device))
+    {
+        perror(device);
+        return 1;
+    }
+    CAP129n cap(model);
+    int status = cap.begin(transport, address);
+    if (status != BEGIN_SUCCESS)
+    {
+        fprintf(stderr, "%s: begin() failed with %d at 0x%02X\n", device, status, address);
+        return 1;
+    }
+    fprintf(stderr, "CAP%x at 0x%02X on %s, started in %lu us\n", model == MODEL_CAP1293 ? 0x1293 : (model == MODEL_CAP1296 ? 0x1296 : 0x1298),
+            address, device, cap.getStartupTime());
+
+    CAP129nScheduler scheduler(cap);
+    TouchEvent event;
+    for (;;)
+    {
+        scheduler.service();
+        while (cap.readEvent(event))
+            printf("%lu %u %s\n", event.timestamp, event.channel, eventName(event.type));
+        fflush(stdout);
+        delay(1);
+    }
+}
@@ -7,6 +7,7 @@
 
 #include "CAP129n_registers.h"
 #include "CAP129n.h"
+#include "CAP129n_profile.h"
  
  
 /*
@@ -24,9 +25,17 @@ CAP129n::CAP129n(uint8_t specifiedModel, byte addr){
  */
 int CAP129n::begin(TwoWire &wirePort, uint8_t deviceAddress, uint8_t sensitivity, bool interrupts, bool sgEnable)
 {
-    // Set device address and wire port to private variable
+    _wireTransport = CAP129nWireTransport(wirePort);
+    return begin(_wireTransport, deviceAddress, sensitivity, interrupts, sgEnable);
+}
+
+int CAP129n::begin(CAP129nTransport &transport, uint8_t deviceAddress, uint8_t sensitivity, bool interrupts, bool sgEnable)
+{
+    CAP129N_TIME(_stats, STAT_OP_BEGIN);
+    unsigned long start = micros();
+    // Set device address and transport to private variable
     _deviceAddress = deviceAddress;
-    _i2cPort = &wirePort;
+    _transport = &transport;
 	_singalGuardEnabled = sgEnable;
 	
     if (isConnected() == false)
@@ -42,6 +51,9 @@ int CAP129n::begin(TwoWire &wirePort, uint8_t deviceAddress, uint8_t sensitivity
         return ERR_WRONG_PROD_ID;
     }
 
+    // Fill the register shadow once, every setter below is a single write
+    resync();
+
     setSensitivity(sensitivity); 
 	
 	//Signal Guard, if enabled disables touch 2
@@ -59,9 +71,74 @@ int CAP129n::begin(TwoWire &wirePort, uint8_t deviceAddress, uint8_t sensitivity
 		setInterruptDisabled();
 	
     clearInterrupt();               // Clear interrupt on startup
+    _startupMicros = micros() - start;
     return BEGIN_SUCCESS;
 }
 
+/*
+ *	Fast startup for a freshly powered chip. Identity is confirmed with a
+ *	single burst read of PROD_ID..REVISION instead of probing, the profile
+ *	is pushed as full-block bursts (the first one split around its two
+ *	reserved registers) and INT is cleared in the same write that sets
+ *	MAIN_CONTROL, seven transactions in total. The power button registers
+ *	are left to be read on first use.
+ *	A NACK on the identity read returns ERR_NO_DEVICE_AT_ADDRESS, any other
+ *	failed transfer returns its ERR_I2C_* code.
+ */
+int CAP129n::beginFast(const CAP129nConfig &config, TwoWire &wirePort, uint8_t deviceAddress)
+{
+    _wireTransport = CAP129nWireTransport(wirePort);
+    return beginFast(config, _wireTransport, deviceAddress);
+}
+
+int CAP129n::beginFast(const CAP129nConfig &config, CAP129nTransport &transport, uint8_t deviceAddress)
+{
+    CAP129N_TIME(_stats, STAT_OP_BEGIN);
+    unsigned long start = micros();
+    _deviceAddress = deviceAddress;
+    _transport = &transport;
+    invalidate();
+
+    byte identity[REVISION - PROD_ID + 1] = {0};
+    int status = readRegisters(PROD_ID, identity, sizeof(identity));
+    if (status == ERR_I2C_NACK)
+    {
+        return ERR_NO_DEVICE_AT_ADDRESS;
+    }
+    if (status != I2C_SUCCESS)
+    {
+        return status;
+    }
+    if (identity[0] != _specifiedModel)
+    {
+        return ERR_WRONG_PROD_ID;
+    }
+
+    apply(config, true);
+    if (_lastError != I2C_SUCCESS)
+    {
+        return _lastError;
+    }
+    status = writeRegister(MAIN_CONTROL, 0x00);
+    if (status != I2C_SUCCESS)
+    {
+        return status;
+    }
+    _shadowValid |= SHADOW_VALID_MAIN_CONTROL;
+    _singalGuardEnabled = config.registerValue(SIGNAL_GUARD_ENABLE) != 0x00;
+
+    _startupMicros = micros() - start;
+    return BEGIN_SUCCESS;
+}
+
+/*
+ *	Time the last begin() or beginFast() took, in microseconds.
+ */
+unsigned long CAP129n::getStartupTime()
+{
+    return _startupMicros;
+}
+
 /*
  *	Returns true if device ACKs the connection, false otherwise
  */
@@ -70,8 +147,7 @@ bool CAP129n::isConnected()
     for (byte i = 0; i < 5; i++)
     {
         // Apparently it's possible that sometimes the device only acknowelages the connection after about 2 tries so compensate for that. 
-        _i2cPort->beginTransmission((uint8_t)_deviceAddress);
-        if (_i2cPort->endTransmission() == 0)
+        if (_transport->probe(_deviceAddress) == I2C_SUCCESS)
             return (true); 
     }
 
@@ -93,30 +169,161 @@ void CAP129n::checkStatus()
 void CAP129n::clearInterrupt()
 {
     MAIN_CONTROL_REG reg;
-    reg.MAIN_CONTROL_COMBINED = readRegister(MAIN_CONTROL);
+    reg.MAIN_CONTROL_COMBINED = readForUpdate(MAIN_CONTROL);
     reg.MAIN_CONTROL_FIELDS.INT = 0x00;
     writeRegister(MAIN_CONTROL, reg.MAIN_CONTROL_COMBINED);
 }
 
+/*
+ *	Marks the register shadow as stale. Call this if the chip was reset or
+ *	reconfigured behind the library's back; setters fall back to
+ *	read-modify-write until resync() is called.
+ */
+void CAP129n::invalidate()
+{
+    _shadowValid = 0x00;
+}
+
+/*
+ *	Reloads the register shadow from the chip, one burst read per
+ *	contiguous block of writable registers. A block whose read failed
+ *	stays invalid.
+ */
+void CAP129n::resync()
+{
+    _shadowValid = 0x00;
+    if (readRegisters(MAIN_CONTROL, &_shadow[SHADOW_MAIN_CONTROL], 1) == I2C_SUCCESS)
+        _shadowValid |= SHADOW_VALID_MAIN_CONTROL;
+    if (readRegisters(SENSITIVITY_CONTROL, &_shadow[SHADOW_CONFIG_BLOCK], SHADOW_CONFIG_BLOCK_LEN) == I2C_SUCCESS)
+        _shadowValid |= SHADOW_VALID_CONFIG;
+    if (readRegisters(SENSOR_1_INPUT_THRESH, &_shadow[SHADOW_THRESH_BLOCK], SHADOW_THRESH_BLOCK_LEN) == I2C_SUCCESS)
+        _shadowValid |= SHADOW_VALID_THRESH;
+    if (readRegisters(STANDBY_CHANNEL, &_shadow[SHADOW_STANDBY_BLOCK], SHADOW_STANDBY_BLOCK_LEN) == I2C_SUCCESS)
+        _shadowValid |= SHADOW_VALID_STANDBY;
+    if (readRegisters(POWER_BUTTON, &_shadow[SHADOW_POWER_BLOCK], SHADOW_POWER_BLOCK_LEN) == I2C_SUCCESS)
+        _shadowValid |= SHADOW_VALID_POWER;
+
+    // Bits the chip clears on its own are never kept in the shadow
+    _shadow[SHADOW_MAIN_CONTROL] &= ~MAIN_CONTROL_INT_MASK;
+    _shadow[SHADOW_CONFIG_BLOCK + (CALIBRATION_ACTIVATE_AND_STATUS - SENSITIVITY_CONTROL)] = 0x00;
+}
+
+/*
+ *	Writes a configuration profile. Within each register block only the
+ *	span from the first to the last register that differs from the shadow
+ *	is sent, as a single auto-increment burst. Registers in that span the
+ *	profile does not own keep their current value (calibration is written
+ *	as 0, which is a no-op). With "force", or when the shadow is stale,
+ *	every block is written in full; without a shadow the reserved
+ *	registers have no known value, so the burst is split around them.
+ *	Stops at the first failed burst, see getLastError().
+ *	Returns the number of bursts written.
+ */
+uint8_t CAP129n::apply(const CAP129nConfig &config, bool force)
+{
+    uint8_t block = 0;
+    uint8_t offset = 0;
+    uint8_t bursts = 0;
+    CAP129N_TIME(_stats, STAT_OP_APPLY);
+
+    while (applyBurst(config, force, block, offset))
+    {
+        if (_lastError != I2C_SUCCESS)
+            break;
+        bursts++;
+    }
+    return bursts;
+}
+
+/*
+ *	One burst of apply(), searching from register "offset" of block
+ *	"block" on. Both are moved past a written burst and left alone when it
+ *	failed, so the same call retries it. Returns false once nothing is
+ *	left to write, otherwise the result is in getLastError().
+ */
+bool CAP129n::applyBurst(const CAP129nConfig &config, bool force, uint8_t &block, uint8_t &offset)
+{
+    static const uint8_t blockStart[] = {SENSITIVITY_CONTROL, SENSOR_1_INPUT_THRESH, STANDBY_CHANNEL};
+    static const uint8_t blockLength[] = {SHADOW_CONFIG_BLOCK_LEN, SHADOW_THRESH_BLOCK_LEN, SHADOW_STANDBY_BLOCK_LEN};
+    static const uint8_t blockShadow[] = {SHADOW_CONFIG_BLOCK, SHADOW_THRESH_BLOCK, SHADOW_STANDBY_BLOCK};
+    static const uint8_t blockValid[] = {SHADOW_VALID_CONFIG, SHADOW_VALID_THRESH, SHADOW_VALID_STANDBY};
+
+    for (; block < sizeof(blockStart); block++, offset = 0)
+    {
+        uint8_t b = block;
+        bool valid = (_shadowValid & blockValid[b]) != 0;
+        bool full = force || !valid;
+        int8_t first = -1;
+        int8_t last = -1;
+        for (uint8_t i = offset; i < blockLength[b]; i++)
+        {
+            uint8_t reg = blockStart[b] + i;
+            if (!CAP129nConfig::isWritable(reg))
+                continue;
+            if (full || _shadow[blockShadow[b] + i] != config.registerValue(reg))
+            {
+                if (first < 0)
+                    first = i;
+                last = i;
+            }
+        }
+        if (first < 0)
+            continue;
+        // With BUT_LD_TH set the chip copies threshold 1 to every input, rewrite them all
+        if (blockStart[b] + first == SENSOR_1_INPUT_THRESH && (config.registerValue(RECALIBRATION_CONFIG) & RECALIBRATION_BUT_LD_TH) && last < SENSOR_8_INPUT_THRESH - SENSOR_1_INPUT_THRESH)
+            last = SENSOR_8_INPUT_THRESH - SENSOR_1_INPUT_THRESH;
+
+        int8_t end = last;
+        byte buffer[SHADOW_CONFIG_BLOCK_LEN];
+        for (int8_t i = first; i <= last; i++)
+        {
+            uint8_t reg = blockStart[b] + i;
+            if (!valid && CAP129nConfig::isReserved(reg))
+            {
+                end = i - 1;
+                break;
+            }
+            if (CAP129nConfig::isWritable(reg))
+                buffer[i - first] = config.registerValue(reg);
+            else if (reg == CALIBRATION_ACTIVATE_AND_STATUS || !valid)
+                buffer[i - first] = 0x00;
+            else
+                buffer[i - first] = _shadow[blockShadow[b] + i];
+        }
+        if (writeRegisters((CAP129n_Register)(blockStart[b] + first), buffer, end - first + 1) != I2C_SUCCESS)
+            return true;
+        offset = end + 1;
+        if (end == last)
+        {
+            if (full)
+                _shadowValid |= blockValid[b];
+            block++;
+            offset = 0;
+        }
+        return true;
+    }
+    return false;
+}
+
 //-----BEGIN CONFIGURATION-----
 
 void CAP129n::enableSMBusTimeout(){
 	CONFIGURATION_REG reg;
-	reg.CONFIGURATION_COMBINED = readRegister(CONFIG);
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
 	reg.CONFIGURATION_FIELDS.TIMEOUT = 0x01;
 	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
 }
 
 void CAP129n::disableSMBusTimeout(){
 	CONFIGURATION_REG reg;
-	reg.CONFIGURATION_COMBINED = readRegister(CONFIG);
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
 	reg.CONFIGURATION_FIELDS.TIMEOUT = 0x00;
 	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
 }
 
 void CAP129n::setMaximumHoldDuration(uint8_t duration){
 	SENSOR_INPUT_CONFIGURATION_REG reg;
-	reg.SENSOR_INPUT_CONFIGURATION_COMBINED = readRegister(SENSOR_INPUT_CONFIG);
+	reg.SENSOR_INPUT_CONFIGURATION_COMBINED = readForUpdate(SENSOR_INPUT_CONFIG);
 	if(duration == MAX_DURRATION_560) reg.SENSOR_INPUT_CONFIGURATION_FIELDS.MAX_DUR = MAX_DURRATION_560;
 	else if(duration == MAX_DURRATION_840) reg.SENSOR_INPUT_CONFIGURATION_FIELDS.MAX_DUR = MAX_DURRATION_840;
 	else if(duration == MAX_DURRATION_1120) reg.SENSOR_INPUT_CONFIGURATION_FIELDS.MAX_DUR = MAX_DURRATION_1120;
@@ -140,7 +347,7 @@ void CAP129n::setMaximumHoldDuration(uint8_t duration){
 
 void CAP129n::enableMaximumHoldDuration(){
 	CONFIGURATION_REG reg;
-	reg.CONFIGURATION_COMBINED = readRegister(CONFIG);
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
 	reg.CONFIGURATION_FIELDS.MAX_DUR_EN = 0x01;
 	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
 }
@@ -148,40 +355,82 @@ void CAP129n::enableMaximumHoldDuration(){
 
 void CAP129n::disableMaximumHoldDuration(){
 	CONFIGURATION_REG reg;
-	reg.CONFIGURATION_COMBINED = readRegister(CONFIG);
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
 	reg.CONFIGURATION_FIELDS.MAX_DUR_EN = 0x00;
 	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
 }
 
 void CAP129n::enableRFNoiseFilter(){
 	CONFIGURATION_2_REG reg;
-	reg.CONFIGURATION_2_COMBINED = readRegister(CONFIG_2);
+	reg.CONFIGURATION_2_COMBINED = readForUpdate(CONFIG_2);
 	reg.CONFIGURATION_2_FIELDS.DIS_RF_NOISE = 0x00;
 	writeRegister(CONFIG_2, reg.CONFIGURATION_2_COMBINED);
 }
 
 void CAP129n::disableRFNoiseFilter(){
 	CONFIGURATION_2_REG reg;
-	reg.CONFIGURATION_2_COMBINED = readRegister(CONFIG_2);
+	reg.CONFIGURATION_2_COMBINED = readForUpdate(CONFIG_2);
 	reg.CONFIGURATION_2_FIELDS.DIS_RF_NOISE = 0x01;
 	writeRegister(CONFIG_2, reg.CONFIGURATION_2_COMBINED);
 }
 
+void CAP129n::enableAnalogNoiseFilter(){
+	CONFIGURATION_REG reg;
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
+	reg.CONFIGURATION_FIELDS.DIS_ANA_NOISE = 0x00;
+	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
+}
+
+void CAP129n::disableAnalogNoiseFilter(){
+	CONFIGURATION_REG reg;
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
+	reg.CONFIGURATION_FIELDS.DIS_ANA_NOISE = 0x01;
+	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
+}
+
+void CAP129n::enableDigitalNoiseFilter(){
+	CONFIGURATION_REG reg;
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
+	reg.CONFIGURATION_FIELDS.DIS_DIG_NOISE = 0x00;
+	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
+}
+
+void CAP129n::disableDigitalNoiseFilter(){
+	CONFIGURATION_REG reg;
+	reg.CONFIGURATION_COMBINED = readForUpdate(CONFIG);
+	reg.CONFIGURATION_FIELDS.DIS_DIG_NOISE = 0x01;
+	writeRegister(CONFIG, reg.CONFIGURATION_COMBINED);
+}
+
+void CAP129n::enableRFNoiseOnly(){
+	CONFIGURATION_2_REG reg;
+	reg.CONFIGURATION_2_COMBINED = readForUpdate(CONFIG_2);
+	reg.CONFIGURATION_2_FIELDS.SHOW_RF_NOISE = 0x01;
+	writeRegister(CONFIG_2, reg.CONFIGURATION_2_COMBINED);
+}
+
+void CAP129n::disableRFNoiseOnly(){
+	CONFIGURATION_2_REG reg;
+	reg.CONFIGURATION_2_COMBINED = readForUpdate(CONFIG_2);
+	reg.CONFIGURATION_2_FIELDS.SHOW_RF_NOISE = 0x00;
+	writeRegister(CONFIG_2, reg.CONFIGURATION_2_COMBINED);
+}
+
 void CAP129n::enableMultipleTouchLimit(){
 	MULTIPLE_TOUCH_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_CONFIG);
+	reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_CONFIG);
 	reg.MULTIPLE_TOUCH_CONFIGURATION_FIELDS.MULT_BLK_EN = 0x01;
 	writeRegister(MULTIPLE_TOUCH_CONFIG, reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED);
 }
 void CAP129n::disableMultipleTouchLimit(){
 	MULTIPLE_TOUCH_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_CONFIG);
+	reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_CONFIG);
 	reg.MULTIPLE_TOUCH_CONFIGURATION_FIELDS.MULT_BLK_EN = 0x00;
 	writeRegister(MULTIPLE_TOUCH_CONFIG, reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED);
 }
 void CAP129n::setMultipleTouchLimit(uint8_t touches){
 	MULTIPLE_TOUCH_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_CONFIG);
+	reg.MULTIPLE_TOUCH_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_CONFIG);
 	reg.MULTIPLE_TOUCH_CONFIGURATION_FIELDS.MULT_BLK_EN = 0x01;
 	if(touches == 1) reg.MULTIPLE_TOUCH_CONFIGURATION_FIELDS.B_MULT_T = 0x00;
 	else if(touches == 2) reg.MULTIPLE_TOUCH_CONFIGURATION_FIELDS.B_MULT_T = 0x01;
@@ -193,20 +442,20 @@ void CAP129n::setMultipleTouchLimit(uint8_t touches){
 
 void CAP129n::enableMTPDetection(){
 	MULTIPLE_TOUCH_PATTERN_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN_CONFIG);
+	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN_CONFIG);
 	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.MTP_EN = 0x01;
 	writeRegister(MULTIPLE_TOUCH_PATTERN_CONFIG, reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED);
 }
 void CAP129n::disableMTPDetection(){
   	MULTIPLE_TOUCH_PATTERN_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN_CONFIG);
+	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN_CONFIG);
 	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.MTP_EN = 0x00;
 	writeRegister(MULTIPLE_TOUCH_PATTERN_CONFIG, reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED);
 }
 
 void CAP129n::setMTPDetectionTreshold(uint8_t tresh){
 	MULTIPLE_TOUCH_PATTERN_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN_CONFIG);
+	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN_CONFIG);
 	if(tresh == MTP_TRESHOLD_12_5) reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.MTP_TH = 0x00;
 	else if(tresh == MTP_TRESHOLD_25) reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.MTP_TH = 0x01;
 	else if(tresh == MTP_TRESHOLD_37_5) reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.MTP_TH = 0x02;
@@ -215,14 +464,14 @@ void CAP129n::setMTPDetectionTreshold(uint8_t tresh){
 }
 void CAP129n::setMTPDetectionMode(uint8_t mode){
 	MULTIPLE_TOUCH_PATTERN_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN_CONFIG);
+	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN_CONFIG);
 	if(mode == MTP_MODE_SPECIFIC) reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.COMP_PTRN = 0x01;
 	else if(mode == MTP_MODE_MINIMAL_TOUCHES) reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.COMP_PTRN = 0x00;
 	writeRegister(MULTIPLE_TOUCH_PATTERN_CONFIG, reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED);  
 }
 void CAP129n::setMTPPatternSpecificButtons(bool cs1_mtp, bool cs2_mtp, bool cs3_mtp, bool cs4_mtp, bool cs5_mtp, bool cs6_mtp, bool cs7_mtp, bool cs8_mtp){
 	MULTIPLE_TOUCH_PATTERN_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN);
+	reg.MULTIPLE_TOUCH_PATTERN_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN);
 	reg.MULTIPLE_TOUCH_PATTERN_FIELDS.CS1_PTRN = cs1_mtp?0x01:0x00;
 	reg.MULTIPLE_TOUCH_PATTERN_FIELDS.CS2_PTRN = cs2_mtp?0x01:0x00;
 	reg.MULTIPLE_TOUCH_PATTERN_FIELDS.CS3_PTRN = cs3_mtp?0x01:0x00;
@@ -236,7 +485,7 @@ void CAP129n::setMTPPatternSpecificButtons(bool cs1_mtp, bool cs2_mtp, bool cs3_
 
 void CAP129n::setMTPDetectionMinimalButtons(uint8_t btns){
 	MULTIPLE_TOUCH_PATTERN_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN);
+	reg.MULTIPLE_TOUCH_PATTERN_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN);
 	reg.MULTIPLE_TOUCH_PATTERN_FIELDS.CS1_PTRN = (btns>=1)?0x01:0x00;
 	reg.MULTIPLE_TOUCH_PATTERN_FIELDS.CS2_PTRN = (btns>=2)?0x01:0x00;
 	reg.MULTIPLE_TOUCH_PATTERN_FIELDS.CS3_PTRN = (btns>=3)?0x01:0x00;
@@ -250,56 +499,36 @@ void CAP129n::setMTPDetectionMinimalButtons(uint8_t btns){
 
 void CAP129n::enableMTPInterrupt(){
 	MULTIPLE_TOUCH_PATTERN_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN_CONFIG);
+	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN_CONFIG);
 	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.MTP_ALERT = 0x01;
 	writeRegister(MULTIPLE_TOUCH_PATTERN_CONFIG, reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED);  
 }
 
 void CAP129n::disableMTPInterrupt(){
 	MULTIPLE_TOUCH_PATTERN_CONFIGURATION_REG reg;
-	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readRegister(MULTIPLE_TOUCH_PATTERN_CONFIG);
+	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED = readForUpdate(MULTIPLE_TOUCH_PATTERN_CONFIG);
 	reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_FIELDS.MTP_ALERT = 0x00;
 	writeRegister(MULTIPLE_TOUCH_PATTERN_CONFIG, reg.MULTIPLE_TOUCH_PATTERN_CONFIGURATION_COMBINED); 
 }
 
 void CAP129n::disableInterruptRepeatRate(){
-	REPEAT_RATE_ENABLE_REG reg;
-	reg.REPEAT_RATE_ENABLE_COMBINED = readRegister(REPEAT_RATE_ENABLE);
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS1_RPT_EN = 0x00;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS2_RPT_EN = 0x00;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS3_RPT_EN = 0x00;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS4_RPT_EN = 0x00;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS5_RPT_EN = 0x00;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS6_RPT_EN = 0x00;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS7_RPT_EN = 0x00;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS8_RPT_EN = 0x00;	
-	writeRegister(REPEAT_RATE_ENABLE, reg.REPEAT_RATE_ENABLE_COMBINED); 
+	setRepeatMask(0x00);
 }
 
 void CAP129n::enableInterruptRepeatRate(){
-	REPEAT_RATE_ENABLE_REG reg;
-	reg.REPEAT_RATE_ENABLE_COMBINED = readRegister(REPEAT_RATE_ENABLE);	
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS1_RPT_EN = 0x01;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS2_RPT_EN = 0x01;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS3_RPT_EN = 0x01;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS4_RPT_EN = 0x01;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS5_RPT_EN = 0x01;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS6_RPT_EN = 0x01;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS7_RPT_EN = 0x01;
-	reg.REPEAT_RATE_ENABLE_FIELDS.CS8_RPT_EN = 0x01;
-	writeRegister(REPEAT_RATE_ENABLE, reg.REPEAT_RATE_ENABLE_COMBINED); 
+	setRepeatMask(0xFF);
 }
 
 void CAP129n::enableInterruptOnRelease(){
 	CONFIGURATION_2_REG reg;
-	reg.CONFIGURATION_2_COMBINED = readRegister(CONFIG_2);
+	reg.CONFIGURATION_2_COMBINED = readForUpdate(CONFIG_2);
 	reg.CONFIGURATION_2_FIELDS.INT_REL_n= 0x00;
 	writeRegister(CONFIG_2, reg.CONFIGURATION_2_COMBINED); 
 }
 
 void CAP129n::disableInterruptOnRelease(){
 	CONFIGURATION_2_REG reg;
-	reg.CONFIGURATION_2_COMBINED = readRegister(CONFIG_2);
+	reg.CONFIGURATION_2_COMBINED = readForUpdate(CONFIG_2);
 	reg.CONFIGURATION_2_FIELDS.INT_REL_n= 0x01;
 	writeRegister(CONFIG_2, reg.CONFIGURATION_2_COMBINED); 
 }
@@ -307,142 +536,306 @@ void CAP129n::disableInterruptOnRelease(){
 //-----END CONFIGURATION-----
 
 void CAP129n::calibrateTouch(uint8_t id){
-	CALIBRATION_ACTIVATE_AND_STATUS_REG reg;
-    reg.CALIBRATION_ACTIVATE_AND_STATUS_COMBINED = readRegister(CALIBRATION_ACTIVATE_AND_STATUS);
-	if(id == 1) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS1_CAL = 0x01;
-	else if (id == 2) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS2_CAL = 0x01;
-	else if (id == 3) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS3_CAL = 0x01;
-	else if (id == 4) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS4_CAL = 0x01;
-	else if (id == 5) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS5_CAL = 0x01;
-	else if (id == 6) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS6_CAL = 0x01;
-	else if (id == 7) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS7_CAL = 0x01;
-	else if (id == 8) reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS8_CAL = 0x01;
-	writeRegister(CALIBRATION_ACTIVATE_AND_STATUS, reg.CALIBRATION_ACTIVATE_AND_STATUS_COMBINED);
+	calibrateMask(channelMask(id));
 }
 
 void CAP129n::calibrateAll(){
-	CALIBRATION_ACTIVATE_AND_STATUS_REG reg;
-    reg.CALIBRATION_ACTIVATE_AND_STATUS_COMBINED = readRegister(CALIBRATION_ACTIVATE_AND_STATUS);
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS1_CAL = 0x01;
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS2_CAL = 0x01;
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS3_CAL = 0x01;
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS4_CAL = 0x01;
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS5_CAL = 0x01;
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS6_CAL = 0x01;
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS7_CAL = 0x01;
-	reg.CALIBRATION_ACTIVATE_AND_STATUS_FIELDS.CS8_CAL = 0x01;
-	writeRegister(CALIBRATION_ACTIVATE_AND_STATUS, reg.CALIBRATION_ACTIVATE_AND_STATUS_COMBINED);
+	calibrateMask(0xFF);
 }
 
 void CAP129n::setInterruptDisabled()
 {
-    INTERRUPT_ENABLE_REG reg;
-    reg.INTERRUPT_ENABLE_COMBINED = readRegister(INTERRUPT_ENABLE);
-    reg.INTERRUPT_ENABLE_FIELDS.CS1_INT_EN = 0x00;
-    reg.INTERRUPT_ENABLE_FIELDS.CS2_INT_EN = 0x00;
-    reg.INTERRUPT_ENABLE_FIELDS.CS3_INT_EN = 0x00;
-	reg.INTERRUPT_ENABLE_FIELDS.CS4_INT_EN = 0x00;
-	reg.INTERRUPT_ENABLE_FIELDS.CS5_INT_EN = 0x00;
-	reg.INTERRUPT_ENABLE_FIELDS.CS6_INT_EN = 0x00;
-	reg.INTERRUPT_ENABLE_FIELDS.CS7_INT_EN = 0x00;
-	reg.INTERRUPT_ENABLE_FIELDS.CS8_INT_EN = 0x00;
-    writeRegister(INTERRUPT_ENABLE, reg.INTERRUPT_ENABLE_COMBINED);
+    setInterruptMask(0x00);
 }
 
 void CAP129n::setInterruptEnabled()
 {
-    INTERRUPT_ENABLE_REG reg;
-    reg.INTERRUPT_ENABLE_COMBINED = readRegister(INTERRUPT_ENABLE);
-    reg.INTERRUPT_ENABLE_FIELDS.CS1_INT_EN = 0x01;
-    reg.INTERRUPT_ENABLE_FIELDS.CS2_INT_EN = 0x01;
-    reg.INTERRUPT_ENABLE_FIELDS.CS3_INT_EN = 0x01;
-	reg.INTERRUPT_ENABLE_FIELDS.CS4_INT_EN = 0x01;
-	reg.INTERRUPT_ENABLE_FIELDS.CS5_INT_EN = 0x01;
-	reg.INTERRUPT_ENABLE_FIELDS.CS6_INT_EN = 0x01;
-	reg.INTERRUPT_ENABLE_FIELDS.CS7_INT_EN = 0x01;
-	reg.INTERRUPT_ENABLE_FIELDS.CS8_INT_EN = 0x01;
-    writeRegister(INTERRUPT_ENABLE, reg.INTERRUPT_ENABLE_COMBINED);
+    setInterruptMask(0xFF);
 }
 
 void CAP129n::enableSensing(uint8_t id){
-	SENSOR_INPUT_ENABLE_REG reg;
-	reg.SENSOR_INPUT_ENABLE_COMBINED = readRegister(SENSOR_INPUT_ENABLE);
-	if (id == 1) reg.SENSOR_INPUT_ENABLE_FIELDS.CS1_EN = 0x01;
-	else if (id == 2) reg.SENSOR_INPUT_ENABLE_FIELDS.CS2_EN = 0x01;
-	else if (id == 3) reg.SENSOR_INPUT_ENABLE_FIELDS.CS3_EN = 0x01;
-	else if (id == 4) reg.SENSOR_INPUT_ENABLE_FIELDS.CS4_EN = 0x01;
-	else if (id == 5) reg.SENSOR_INPUT_ENABLE_FIELDS.CS5_EN = 0x01;
-	else if (id == 6) reg.SENSOR_INPUT_ENABLE_FIELDS.CS6_EN = 0x01;
-	else if (id == 7) reg.SENSOR_INPUT_ENABLE_FIELDS.CS7_EN = 0x01;
-	else if (id == 8) reg.SENSOR_INPUT_ENABLE_FIELDS.CS8_EN = 0x01;
-	writeRegister(SENSOR_INPUT_ENABLE, reg.SENSOR_INPUT_ENABLE_COMBINED);
+	updateRegisterBits(SENSOR_INPUT_ENABLE, channelMask(id), 0xFF);
 }
 
 void CAP129n::disableSensing(uint8_t id){
-	SENSOR_INPUT_ENABLE_REG reg;
-	reg.SENSOR_INPUT_ENABLE_COMBINED = readRegister(SENSOR_INPUT_ENABLE);
-	if (id == 1) reg.SENSOR_INPUT_ENABLE_FIELDS.CS1_EN = 0x00;
-	else if (id == 2) reg.SENSOR_INPUT_ENABLE_FIELDS.CS2_EN = 0x00;
-	else if (id == 3) reg.SENSOR_INPUT_ENABLE_FIELDS.CS3_EN = 0x00;
-	else if (id == 4) reg.SENSOR_INPUT_ENABLE_FIELDS.CS4_EN = 0x00;
-	else if (id == 5) reg.SENSOR_INPUT_ENABLE_FIELDS.CS5_EN = 0x00;
-	else if (id == 6) reg.SENSOR_INPUT_ENABLE_FIELDS.CS6_EN = 0x00;
-	else if (id == 7) reg.SENSOR_INPUT_ENABLE_FIELDS.CS7_EN = 0x00;
-	else if (id == 8) reg.SENSOR_INPUT_ENABLE_FIELDS.CS8_EN = 0x00;
-	writeRegister(SENSOR_INPUT_ENABLE, reg.SENSOR_INPUT_ENABLE_COMBINED);
+	updateRegisterBits(SENSOR_INPUT_ENABLE, channelMask(id), 0x00);
 }
 
 bool CAP129n::isEnabledSensing(uint8_t id){
-	SENSOR_INPUT_ENABLE_REG reg;
-	reg.SENSOR_INPUT_ENABLE_COMBINED = readRegister(SENSOR_INPUT_ENABLE);
-	if (id == 1) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS1_EN == 0x01);
-	else if (id == 2) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS2_EN == 0x01);
-	else if (id == 3) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS3_EN == 0x01);
-	else if (id == 4) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS4_EN == 0x01);
-	else if (id == 5) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS5_EN == 0x01);
-	else if (id == 6) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS6_EN == 0x01);
-	else if (id == 7) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS7_EN == 0x01);
-	else if (id == 8) return (reg.SENSOR_INPUT_ENABLE_FIELDS.CS8_EN == 0x01);
-	
-	return false;
+	return (readCachedRegister(SENSOR_INPUT_ENABLE) & channelMask(id)) != 0;
 }
 
 void CAP129n::enableSignalGuard(){
-	disableSensing(2);
-	SIGNAL_GUARD_ENABLE_REG reg;
-	reg.SIGNAL_GUARD_ENABLE_COMBINED = readRegister(SIGNAL_GUARD_ENABLE);
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS1_SG_EN = 0x01;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS2_SG_EN = 0x01;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS3_SG_EN = 0x01;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS4_SG_EN = 0x01;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS5_SG_EN = 0x01;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS6_SG_EN = 0x01;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS7_SG_EN = 0x01;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS8_SG_EN = 0x01;
-	writeRegister(SIGNAL_GUARD_ENABLE, reg.SIGNAL_GUARD_ENABLE_COMBINED);	
-	_singalGuardEnabled = true;
+	setSignalGuardMask(0xFF);
 }
 
 void CAP129n::disableSignalGuard(){
-	SIGNAL_GUARD_ENABLE_REG reg;
-	reg.SIGNAL_GUARD_ENABLE_COMBINED = readRegister(SIGNAL_GUARD_ENABLE);
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS1_SG_EN = 0x00;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS2_SG_EN = 0x00;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS3_SG_EN = 0x00;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS4_SG_EN = 0x00;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS5_SG_EN = 0x00;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS6_SG_EN = 0x00;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS7_SG_EN = 0x00;
-	reg.SIGNAL_GUARD_ENABLE_FIELDS.CS8_SG_EN = 0x00;
-	writeRegister(SIGNAL_GUARD_ENABLE, reg.SIGNAL_GUARD_ENABLE_COMBINED);	
-	_singalGuardEnabled = false;
+	setSignalGuardMask(0x00);
+}
+
+//-----BEGIN NOISE DIAGNOSTICS-----
+
+/*
+ *	With capture on, poll() reads MAIN_CONTROL..NOISE_FLAG_STATUS in its
+ *	one burst (11 bytes instead of 4) and counts the flagged inputs. The
+ *	chip drops a flagged input's sample, so every flag seen is a discarded
+ *	sample; samples between two polls are not seen.
+ */
+void CAP129n::setNoiseCapture(bool enabled){
+	_noiseCapture = enabled;
+	_snapshot.noiseFlags = 0x00;
+}
+
+unsigned long CAP129n::getNoiseCount(uint8_t id){
+	if (id < 1 || id > 8)
+		return 0;
+	return _noiseCounts[id - 1];
+}
+
+uint8_t CAP129n::getNoiseRate(uint8_t id){
+	if (id < 1 || id > 8 || _noiseCaptures == 0)
+		return 0;
+	unsigned long count = _noiseCounts[id - 1];
+	unsigned long captures = _noiseCaptures;
+	while (count > 0xFFFFFFFFUL / 100){	//Keep count * 100 in 32 bits
+		count >>= 1;
+		captures >>= 1;
+	}
+	return (uint8_t)((count * 100) / captures);
+}
+
+unsigned long CAP129n::getDiscardedSamples(){
+	unsigned long total = 0;
+	for (uint8_t i = 0; i < 8; i++)
+		total += _noiseCounts[i];
+	return total;
+}
+
+// Number of polls that read the noise flags
+unsigned long CAP129n::getNoiseCaptures(){
+	return _noiseCaptures;
+}
+
+void CAP129n::resetNoiseStats(){
+	memset(_noiseCounts, 0, sizeof(_noiseCounts));
+	_noiseCaptures = 0;
+}
+
+//-----END NOISE DIAGNOSTICS-----
+
+//-----BEGIN POWER MANAGEMENT-----
+
+/*
+ *	Standby only senses the inputs in "wakeMask", with its own sensitivity,
+ *	threshold and averaging. The standby block (0x40..0x43) is written in
+ *	one burst, and skipped when it already holds these values.
+ */
+void CAP129n::enterStandby(uint8_t wakeMask, uint8_t sensitivity, uint8_t threshold, uint8_t standbyConfig){
+	byte buffer[STANDBY_THRESH - STANDBY_CHANNEL + 1];
+	buffer[STANDBY_CHANNEL - STANDBY_CHANNEL] = wakeMask;
+	buffer[STANDBY_CONFIG - STANDBY_CHANNEL] = standbyConfig;
+	buffer[STANDBY_SENSITIVITY - STANDBY_CHANNEL] = (sensitivity > SENSITIVITY_1X) ? SENSITIVITY_32X : sensitivity;
+	buffer[STANDBY_THRESH - STANDBY_CHANNEL] = threshold & 0x7F;
+
+	bool changed = !(_shadowValid & SHADOW_VALID_STANDBY);
+	for (uint8_t i = 0; i < sizeof(buffer) && !changed; i++)
+		changed = _shadow[SHADOW_STANDBY_BLOCK + i] != buffer[i];
+	if (changed)
+		writeRegisters(STANDBY_CHANNEL, buffer, sizeof(buffer));
+
+	updateRegisterBits(MAIN_CONTROL, MAIN_CONTROL_STBY_MASK | MAIN_CONTROL_DSLEEP_MASK, MAIN_CONTROL_STBY_MASK);
+}
+
+void CAP129n::enterDeepSleep(){
+	updateRegisterBits(MAIN_CONTROL, MAIN_CONTROL_STBY_MASK | MAIN_CONTROL_DSLEEP_MASK, MAIN_CONTROL_DSLEEP_MASK);
+}
+
+/*
+ *	Back to active sensing with a single MAIN_CONTROL write, the active
+ *	configuration never left the chip. The time from here to the first
+ *	event queued by service() is kept as the wake latency.
+ */
+void CAP129n::wake(){
+	updateRegisterBits(MAIN_CONTROL, MAIN_CONTROL_STBY_MASK | MAIN_CONTROL_DSLEEP_MASK, 0x00);
+	_wakeMicros = micros();
+	_wakePending = true;
+}
+
+uint8_t CAP129n::getPowerState(){
+	byte control = readCachedRegister(MAIN_CONTROL);
+	if (control & MAIN_CONTROL_DSLEEP_MASK)
+		return POWER_DEEP_SLEEP;
+	if (control & MAIN_CONTROL_STBY_MASK)
+		return POWER_STANDBY;
+	return POWER_ACTIVE;
+}
+
+// Microseconds from the last wake() to the first event after it
+unsigned long CAP129n::getWakeLatency(){
+	return _wakeLatency;
+}
+
+/*
+ *	Assigns input "id" as the power button. The hold times are
+ *	POWER_BUTTON_TIME_* and apply while active and in standby; both
+ *	registers go out in one burst.
+ */
+void CAP129n::setPowerButton(uint8_t id, uint8_t activeTime, uint8_t standbyTime, bool activeEnabled, bool standbyEnabled){
+	if (id < 1 || id > getChannelCount())
+		return;
+	byte buffer[2];
+	buffer[0] = id - 1;
+	buffer[1] = ((standbyTime & 0x03) << 4) | (activeTime & 0x03);
+	if (activeEnabled)
+		buffer[1] |= POWER_BUTTON_PWR_EN;
+	if (standbyEnabled)
+		buffer[1] |= POWER_BUTTON_STBY_PWR_EN;
+	writeRegisters(POWER_BUTTON, buffer, sizeof(buffer));
+}
+
+void CAP129n::disablePowerButton(){
+	updateRegisterBits(POWER_BUTTON_CONFIG, POWER_BUTTON_PWR_EN | POWER_BUTTON_STBY_PWR_EN, 0x00);
+}
+
+// Input id of the power button, 0 when it is disabled in both states
+uint8_t CAP129n::getPowerButton(){
+	if (!(readCachedRegister(POWER_BUTTON_CONFIG) & (POWER_BUTTON_PWR_EN | POWER_BUTTON_STBY_PWR_EN)))
+		return 0;
+	return (readCachedRegister(POWER_BUTTON) & 0x07) + 1;
+}
+
+//-----END POWER MANAGEMENT-----
+
+//-----BEGIN THRESHOLDS-----
+/*
+ *	Touch thresholds are 7 bit per input, the noise threshold is 2 bit.
+ */
+
+/*
+ *	Writes all eight touch thresholds and the noise threshold
+ *	(0x30..0x38) in one burst.
+ */
+void CAP129n::setThresholds(const uint8_t thresholds[8], uint8_t noiseThreshold){
+	byte buffer[SENSOR_INPUT_NOISE_THRESH - SENSOR_1_INPUT_THRESH + 1];
+	for (uint8_t i = 0; i < 8; i++)
+		buffer[i] = thresholds[i] & 0x7F;
+	buffer[8] = noiseThreshold & 0x03;
+	writeRegisters(SENSOR_1_INPUT_THRESH, buffer, sizeof(buffer));
+}
+
+/*
+ *	Reads all eight touch thresholds and the noise threshold back from the
+ *	chip in one burst. Returns the I2C status, the outputs are left
+ *	untouched if the read failed.
+ */
+int CAP129n::readThresholds(uint8_t thresholds[8], uint8_t &noiseThreshold){
+	byte buffer[SENSOR_INPUT_NOISE_THRESH - SENSOR_1_INPUT_THRESH + 1] = {0};
+	int status = readRegisters(SENSOR_1_INPUT_THRESH, buffer, sizeof(buffer));
+	if (status != I2C_SUCCESS)
+		return status;
+	memcpy(thresholds, buffer, 8);
+	noiseThreshold = buffer[8];
+	return I2C_SUCCESS;
+}
+
+/*
+ *	A lone write to the input 1 threshold is copied to every input while
+ *	BUT_LD_TH is set, so in that case all eight are rewritten in one burst.
+ */
+void CAP129n::setThreshold(uint8_t id, uint8_t threshold){
+	if (id < 1 || id > 8)
+		return;
+	if (id == 1 && (readCachedRegister(RECALIBRATION_CONFIG) & RECALIBRATION_BUT_LD_TH))
+	{
+		byte buffer[8];
+		for (uint8_t i = 0; i < 8; i++)
+			buffer[i] = readForUpdate((CAP129n_Register)(SENSOR_1_INPUT_THRESH + i));
+		buffer[0] = threshold & 0x7F;
+		writeRegisters(SENSOR_1_INPUT_THRESH, buffer, sizeof(buffer));
+		return;
+	}
+	writeRegister((CAP129n_Register)(SENSOR_1_INPUT_THRESH + id - 1), threshold & 0x7F);
+}
+
+uint8_t CAP129n::getThreshold(uint8_t id){
+	if (id < 1 || id > 8)
+		return 0;
+	return readCachedRegister((CAP129n_Register)(SENSOR_1_INPUT_THRESH + id - 1));
+}
+
+void CAP129n::setNoiseThreshold(uint8_t threshold){
+	writeRegister(SENSOR_INPUT_NOISE_THRESH, threshold & 0x03);
+}
+
+//-----END THRESHOLDS-----
+
+//-----BEGIN CHANNEL MASKS-----
+/*
+ *	Bit 0 is CS1 ... bit 7 is CS8. Every setter replaces the whole register
+ *	in a single write.
+ */
+
+void CAP129n::setSensingMask(uint8_t mask){
+	writeRegister(SENSOR_INPUT_ENABLE, mask);
 }
 
+uint8_t CAP129n::getSensingMask(){
+	return readCachedRegister(SENSOR_INPUT_ENABLE);
+}
+
+void CAP129n::setInterruptMask(uint8_t mask){
+	writeRegister(INTERRUPT_ENABLE, mask);
+}
+
+uint8_t CAP129n::getInterruptMask(){
+	return readCachedRegister(INTERRUPT_ENABLE);
+}
+
+void CAP129n::setRepeatMask(uint8_t mask){
+	writeRegister(REPEAT_RATE_ENABLE, mask);
+}
+
+uint8_t CAP129n::getRepeatMask(){
+	return readCachedRegister(REPEAT_RATE_ENABLE);
+}
+
+/*
+ *	The signal guard is driven on the CS2 pin, so enabling it for any input
+ *	also disables touch sensing on CS2.
+ */
+void CAP129n::setSignalGuardMask(uint8_t mask){
+	if (mask != 0x00)
+		disableSensing(2);
+	writeRegister(SIGNAL_GUARD_ENABLE, mask);
+	_singalGuardEnabled = (mask != 0x00);
+}
+
+uint8_t CAP129n::getSignalGuardMask(){
+	return readCachedRegister(SIGNAL_GUARD_ENABLE);
+}
+
+/*
+ *	Calibration bits are write-1-to-start and clear themselves once the
+ *	calibration finishes, so writing 0 to the other channels is a no-op and
+ *	no read is needed.
+ */
+void CAP129n::calibrateMask(uint8_t mask){
+	if (mask)
+		writeRegister(CALIBRATION_ACTIVATE_AND_STATUS, mask);
+}
+
+// Inputs whose calibration is still running
+uint8_t CAP129n::getCalibratingMask(){
+	return readRegister(CALIBRATION_ACTIVATE_AND_STATUS);
+}
+
+//-----END CHANNEL MASKS-----
+
 /*	CAP1293 only for now, so not used in universal library, too lazy to implement for others right now
 bool CAP129n::isInterruptEnabled()
 {
     INTERRUPT_ENABLE_REG reg;
-    reg.INTERRUPT_ENABLE_COMBINED = readRegister(INTERRUPT_ENABLE);
+    reg.INTERRUPT_ENABLE_COMBINED = readCachedRegister(INTERRUPT_ENABLE);
     if (reg.INTERRUPT_ENABLE_FIELDS.CS1_INT_EN == 0x01 && reg.INTERRUPT_ENABLE_FIELDS.CS2_INT_EN == 0x01 && reg.INTERRUPT_ENABLE_FIELDS.CS3_INT_EN == 0x01)
     {
         return true;
@@ -453,7 +846,7 @@ bool CAP129n::isInterruptEnabled()
 void CAP129n::setSensitivity(uint8_t sensitivity)
 {
     SENSITIVITY_CONTROL_REG reg;
-    reg.SENSITIVITY_CONTROL_COMBINED = readRegister(SENSITIVITY_CONTROL);
+    reg.SENSITIVITY_CONTROL_COMBINED = readForUpdate(SENSITIVITY_CONTROL);
     if (sensitivity == SENSITIVITY_128X)
     {
         reg.SENSITIVITY_CONTROL_FIELDS.DELTA_SENSE = SENSITIVITY_128X;
@@ -496,7 +889,7 @@ void CAP129n::setSensitivity(uint8_t sensitivity)
 uint8_t CAP129n::getSensitivity()
 {
     SENSITIVITY_CONTROL_REG reg;
-    reg.SENSITIVITY_CONTROL_COMBINED = readRegister(SENSITIVITY_CONTROL);
+    reg.SENSITIVITY_CONTROL_COMBINED = readCachedRegister(SENSITIVITY_CONTROL);
     uint16_t sensitivity = reg.SENSITIVITY_CONTROL_FIELDS.DELTA_SENSE;
     if (sensitivity == SENSITIVITY_128X)
     {
@@ -562,23 +955,255 @@ bool CAP129n::isMTPTouched(){
 }
 
 bool CAP129n::isTouched(uint8_t id){
-	SENSOR_INPUT_STATUS_REG reg;
-    reg.SENSOR_INPUT_STATUS_COMBINED = readRegister(SENSOR_INPUT_STATUS);
-	bool isTouched = false;
-	if ((id == 1) && reg.SENSOR_INPUT_STATUS_FIELDS.CS1 == ON) isTouched = true;
-	else if ((id == 2) && reg.SENSOR_INPUT_STATUS_FIELDS.CS2 == ON) isTouched = true;
-	else if ((id == 3) && reg.SENSOR_INPUT_STATUS_FIELDS.CS3 == ON) isTouched = true;
-	else if ((id == 4) && reg.SENSOR_INPUT_STATUS_FIELDS.CS4 == ON) isTouched = true;
-	else if ((id == 5) && reg.SENSOR_INPUT_STATUS_FIELDS.CS5 == ON) isTouched = true;
-	else if ((id == 6) && reg.SENSOR_INPUT_STATUS_FIELDS.CS6 == ON) isTouched = true;
-	else if ((id == 7) && reg.SENSOR_INPUT_STATUS_FIELDS.CS7 == ON) isTouched = true;
-	else if ((id == 8) && reg.SENSOR_INPUT_STATUS_FIELDS.CS8 == ON) isTouched = true;
+	bool isTouched = (readRegister(SENSOR_INPUT_STATUS) & channelMask(id)) != 0;
 	if (isTouched)
     {
         clearInterrupt();
     }
 	return isTouched;
 }
+/*
+ *	Reads MAIN_CONTROL, GENERAL_STATUS and SENSOR_INPUT_STATUS in a single
+ *	burst and clears INT with one write if it was set. The result stays
+ *	available through getSnapshot() until the next poll.
+ */
+const TouchSnapshot &CAP129n::poll()
+{
+    byte buffer[NOISE_FLAG_STATUS - MAIN_CONTROL + 1] = {0};
+    uint8_t len = pollLength();
+    CAP129N_TIME(_stats, STAT_OP_POLL);
+    if (readRegisters(MAIN_CONTROL, buffer, len) != I2C_SUCCESS)
+        return _snapshot;	//Keep the last good snapshot
+
+    if (storeSnapshot(buffer, len))
+    {
+        writeRegister(MAIN_CONTROL, buffer[MAIN_CONTROL] & ~MAIN_CONTROL_INT_MASK);
+    }
+    return _snapshot;
+}
+
+/*
+ *	The status burst and the delta counts go out as one transport batch,
+ *	a single combined transfer where the bus supports it. "deltas" is left
+ *	untouched if the read failed.
+ */
+const TouchSnapshot &CAP129n::poll(int8_t deltas[8])
+{
+    byte buffer[NOISE_FLAG_STATUS - MAIN_CONTROL + 1] = {0};
+    int8_t counts[8] = {0};
+    uint8_t len = pollLength();
+    CAP129N_TIME(_stats, STAT_OP_POLL);
+    CAP129nRead reads[2] = {
+        {MAIN_CONTROL, buffer, len},
+        {SENSOR_INPUT_1_DELTA_COUNT, (uint8_t *)counts, getChannelCount()}};
+    if (readBatch(reads, 2) != I2C_SUCCESS)
+        return _snapshot;
+
+    memcpy(deltas, counts, reads[1].len);
+    if (storeSnapshot(buffer, len))
+    {
+        writeRegister(MAIN_CONTROL, buffer[MAIN_CONTROL] & ~MAIN_CONTROL_INT_MASK);
+    }
+    return _snapshot;
+}
+
+// Bytes of the poll burst from MAIN_CONTROL
+uint8_t CAP129n::pollLength()
+{
+    return _noiseCapture ? NOISE_FLAG_STATUS - MAIN_CONTROL + 1 : SENSOR_INPUT_STATUS - MAIN_CONTROL + 1;
+}
+
+/*
+ *	Stores a burst read of MAIN_CONTROL..SENSOR_INPUT_STATUS, or up to
+ *	NOISE_FLAG_STATUS, as the current snapshot. Returns true if INT is set
+ *	and needs clearing.
+ */
+bool CAP129n::storeSnapshot(const byte *buffer, uint8_t len)
+{
+    _snapshot.mainControl = buffer[MAIN_CONTROL];
+    _snapshot.generalStatus = buffer[GENERAL_STATUS];
+    _snapshot.inputStatus = buffer[SENSOR_INPUT_STATUS];
+    if (len > NOISE_FLAG_STATUS)
+    {
+        uint8_t flags = buffer[NOISE_FLAG_STATUS];
+        _snapshot.noiseFlags = flags;
+        _noiseCaptures++;
+        for (uint8_t i = 0; flags; i++, flags >>= 1)
+            if (flags & 0x01)
+                _noiseCounts[i]++;
+    }
+    return (buffer[MAIN_CONTROL] & MAIN_CONTROL_INT_MASK) != 0;
+}
+
+const TouchSnapshot &CAP129n::getSnapshot()
+{
+    return _snapshot;
+}
+
+/*
+ *	In alert mode the bus is only touched after handleAlert() flagged the
+ *	ALERT pin, or while a channel is still held so its release is not
+ *	missed when interrupt on release is disabled.
+ */
+void CAP129n::setAlertMode(bool enabled)
+{
+    _alertMode = enabled;
+    _alertPending = enabled;	//Pick up anything that happened before the ISR was attached
+}
+
+/*
+ *	ISR-safe, only records that the ALERT pin fired and when.
+ */
+void CAP129n::handleAlert()
+{
+    _alertMicros = micros();
+    _alertPending = true;
+}
+
+/*
+ *	Polls the chip when needed and queues one event per press and release
+ *	edge since the previous call. Returns the number of events queued.
+ */
+uint8_t CAP129n::service()
+{
+    bool alerted = _alertPending;
+    if (_alertMode && !alerted && _lastInputStatus == 0x00)
+        return 0;
+    _alertPending = false;
+    unsigned long timestamp = (_alertMode && alerted) ? _alertMicros : micros();
+    CAP129N_TIME(_stats, STAT_OP_SERVICE);
+
+    const TouchSnapshot &snapshot = poll();
+    if (_lastError != I2C_SUCCESS)
+    {
+        _alertPending = _alertPending || alerted;	//Try again on the next call
+        return 0;
+    }
+    uint8_t status = snapshot.inputStatus;
+    bool powerButton = snapshot.isPowerButton();
+
+    uint8_t changed = status ^ _lastInputStatus;
+    _lastInputStatus = status;
+
+    uint8_t queued = 0;
+    TouchEvent event;
+    event.device = 0;
+    event.timestamp = timestamp;
+    // PWR stays set while the button is held, one event per hold
+    if (powerButton && !_lastPowerButton)
+    {
+        event.channel = (readCachedRegister(POWER_BUTTON) & 0x07) + 1;
+        event.type = TOUCH_EVENT_POWER_BUTTON;
+        if (_events.push(event))
+            queued++;
+    }
+    _lastPowerButton = powerButton;
+    for (uint8_t id = 1; changed; id++, changed >>= 1, status >>= 1)
+    {
+        if (!(changed & 0x01))
+            continue;
+        event.channel = id;
+        event.type = (status & 0x01) ? TOUCH_EVENT_PRESS : TOUCH_EVENT_RELEASE;
+        if (_events.push(event))
+            queued++;
+    }
+    if (queued && _alertMode && alerted)
+        CAP129N_RECORD(_stats, STAT_OP_ALERT_TO_EVENT, micros() - timestamp);
+    if (queued && _wakePending)
+    {
+        _wakeLatency = micros() - _wakeMicros;
+        _wakePending = false;
+    }
+    return queued;
+}
+
+bool CAP129n::readEvent(TouchEvent &event)
+{
+    return _events.pop(event);
+}
+
+uint8_t CAP129n::eventsAvailable()
+{
+    return _events.available();
+}
+
+unsigned long CAP129n::getEventOverflows()
+{
+    return _events.getOverflows();
+}
+
+bool TouchSnapshot::isTouched(uint8_t id) const
+{
+    if (id < 1 || id > 8)
+        return false;
+    return (inputStatus >> (id - 1)) & 0x01;
+}
+
+bool TouchSnapshot::isTouched() const
+{
+    GENERAL_STATUS_REG reg;
+    reg.GENERAL_STATUS_COMBINED = generalStatus;
+    return reg.GENERAL_STATUS_FIELDS.TOUCH == ON;
+}
+
+bool TouchSnapshot::isMTPTouched() const
+{
+    GENERAL_STATUS_REG reg;
+    reg.GENERAL_STATUS_COMBINED = generalStatus;
+    return reg.GENERAL_STATUS_FIELDS.MTP == ON;
+}
+
+bool TouchSnapshot::isNoisy(uint8_t id) const
+{
+    if (id < 1 || id > 8)
+        return false;
+    return (noiseFlags >> (id - 1)) & 0x01;
+}
+
+bool TouchSnapshot::isPowerButton() const
+{
+    GENERAL_STATUS_REG reg;
+    reg.GENERAL_STATUS_COMBINED = generalStatus;
+    return reg.GENERAL_STATUS_FIELDS.CAP_PWR == ON;
+}
+
+/*
+ *	Returns the number of sensor inputs on the configured model.
+ */
+uint8_t CAP129n::getChannelCount()
+{
+    if (_specifiedModel == MODEL_CAP1293)
+        return 3;
+    else if (_specifiedModel == MODEL_CAP1296)
+        return 6;
+    return 8;
+}
+
+/*
+ *	Reads the delta count of every sensor input on the model in one burst.
+ *	Delta counts are signed, out[0] is CS1. Returns 0 and leaves "out"
+ *	untouched if the read failed.
+ */
+uint8_t CAP129n::readDeltaCounts(int8_t out[8])
+{
+    uint8_t channels = getChannelCount();
+    if (readRegisters(SENSOR_INPUT_1_DELTA_COUNT, (byte *)out, channels) != I2C_SUCCESS)
+        return 0;
+    return channels;
+}
+
+/*
+ *	Reads the base count of every sensor input on the model in one burst,
+ *	0 on a failed read as above.
+ */
+uint8_t CAP129n::readBaseCounts(uint8_t out[8])
+{
+    uint8_t channels = getChannelCount();
+    if (readRegisters(SENSOR_INPUT_1_BASE_COUNT, out, channels) != I2C_SUCCESS)
+        return 0;
+    return channels;
+}
+
 // dodano VM
 uint8_t CAP129n::getInputStatus(){
 	uint8_t r=readRegister(SENSOR_INPUT_STATUS);
@@ -594,64 +1219,289 @@ uint8_t CAP129n::getMainControl(){
 
 // kraj dodavanja VM
 
-/* READ A SINGLE REGISTER
-    Read a single byte of data from the CAP129n register "reg"
+/* SHADOW INDEX
+    Returns the position of "reg" in the register shadow, or -1 if the
+    register is not shadowed
 */
-byte CAP129n::readRegister(CAP129n_Register reg)
+int8_t CAP129n::shadowIndex(uint8_t reg)
 {
-    _i2cPort->beginTransmission(_deviceAddress);
-    _i2cPort->write(reg);
-    _i2cPort->endTransmission(false);               // endTransmission but keep the connection active
-    _i2cPort->requestFrom(_deviceAddress, (byte)1); // Ask for 1 byte, once done, bus is released by default
+    if (reg == MAIN_CONTROL)
+        return SHADOW_MAIN_CONTROL;
+    if (reg >= SENSITIVITY_CONTROL && reg <= RECALIBRATION_CONFIG)
+        return SHADOW_CONFIG_BLOCK + (reg - SENSITIVITY_CONTROL);
+    if (reg >= SENSOR_1_INPUT_THRESH && reg <= SENSOR_INPUT_NOISE_THRESH)
+        return SHADOW_THRESH_BLOCK + (reg - SENSOR_1_INPUT_THRESH);
+    if (reg >= STANDBY_CHANNEL && reg <= CONFIG_2)
+        return SHADOW_STANDBY_BLOCK + (reg - STANDBY_CHANNEL);
+    if (reg >= POWER_BUTTON && reg <= POWER_BUTTON_CONFIG)
+        return SHADOW_POWER_BLOCK + (reg - POWER_BUTTON);
+    return -1;
+}
 
-    // Wait for the data to come back
-    if (_i2cPort->available())
-    {
-        return _i2cPort->read(); // Return this one byte
-    }
-    else
+/* CHANNEL MASK
+    Returns the register bit of sensor input "id" (1..8), or 0 for an
+    invalid id
+*/
+uint8_t CAP129n::channelMask(uint8_t id)
+{
+    if (id < 1 || id > 8)
+        return 0x00;
+    return 1 << (id - 1);
+}
+
+/* UPDATE REGISTER BITS
+    Sets the bits of "reg" selected by "mask" to the matching bits of
+    "bits" in a single write, the rest of the register is kept from the
+    shadow. Nothing is written if the register could not be read.
+*/
+int CAP129n::updateRegisterBits(CAP129n_Register reg, uint8_t mask, uint8_t bits)
+{
+    if (mask == 0x00)
+        return I2C_SUCCESS;
+    byte value = readForUpdate(reg);
+    return writeRegister(reg, (value & ~mask) | (bits & mask));
+}
+
+/* SHADOW BLOCK
+    Returns the validity flag of the shadow block holding shadow entry "idx"
+*/
+uint8_t CAP129n::shadowBlock(uint8_t idx)
+{
+    if (idx < SHADOW_CONFIG_BLOCK)
+        return SHADOW_VALID_MAIN_CONTROL;
+    if (idx < SHADOW_THRESH_BLOCK)
+        return SHADOW_VALID_CONFIG;
+    if (idx < SHADOW_STANDBY_BLOCK)
+        return SHADOW_VALID_THRESH;
+    if (idx < SHADOW_POWER_BLOCK)
+        return SHADOW_VALID_STANDBY;
+    return SHADOW_VALID_POWER;
+}
+
+/* READ A CACHED REGISTER
+    Returns the shadow copy of "reg" when it is current, otherwise reads the
+    register from the chip. Registers the chip updates on its own
+    (calibration status, base count out of limit) are always read.
+*/
+byte CAP129n::readCachedRegister(CAP129n_Register reg)
+{
+    int8_t idx = shadowIndex(reg);
+    if (idx >= 0 && (_shadowValid & shadowBlock(idx)) && reg != CALIBRATION_ACTIVATE_AND_STATUS && reg != BASE_COUNT_OUT)
+        return _shadow[idx];
+    return readRegister(reg);
+}
+
+/* READ FOR A READ-MODIFY-WRITE
+    Same as readCachedRegister(), for the first step of a read-modify-write.
+    If the read fails the register is remembered and the write built on it
+    is dropped. The mark only lives until the next write, whatever its
+    register. An error left by an earlier call is cleared first, so a
+    shadow hit never counts as a failed read.
+*/
+byte CAP129n::readForUpdate(CAP129n_Register reg)
+{
+    _lastError = I2C_SUCCESS;
+    byte value = readCachedRegister(reg);
+    if (_lastError != I2C_SUCCESS)
+        _failedRegister = reg;
+    return value;
+}
+
+/* UPDATE THE SHADOW
+    Copies "len" bytes written to the chip, starting at register "reg",
+    into the register shadow
+*/
+void CAP129n::updateShadow(CAP129n_Register reg, const byte *buffer, byte len)
+{
+    for (int i = 0; i < len; i++)
     {
-        return 0;
+        int8_t idx = shadowIndex(reg + i);
+        if (idx < 0)
+            continue;
+        if (reg + i == MAIN_CONTROL)
+            _shadow[idx] = buffer[i] & ~MAIN_CONTROL_INT_MASK;
+        else if (reg + i == CALIBRATION_ACTIVATE_AND_STATUS)
+            _shadow[idx] = 0x00;
+        else if (reg + i == SENSOR_1_INPUT_THRESH && (_shadow[shadowIndex(RECALIBRATION_CONFIG)] & RECALIBRATION_BUT_LD_TH))
+            memset(&_shadow[idx], buffer[i], SENSOR_8_INPUT_THRESH - SENSOR_1_INPUT_THRESH + 1);	//Chip copies it to every input
+        else
+            _shadow[idx] = buffer[i];
     }
 }
 
+/* READ A SINGLE REGISTER
+    Read a single byte of data from the CAP129n register "reg", 0 if the
+    read failed (see getLastError())
+*/
+byte CAP129n::readRegister(CAP129n_Register reg)
+{
+    byte value = 0;
+    readRegisters(reg, &value, 1);
+    return value;
+}
+
 /* READ MULTIPLE REGISTERS
-    Read "en" bytes from the CAP129n, starting at register "reg." Bytes are 
-    stored in "buffer" on exit.
+    Read "len" bytes from the CAP129n, starting at register "reg." Bytes are 
+    stored in "buffer" on exit, the buffer is left untouched if the read
+    failed after every retry.
 */
-void CAP129n::readRegisters(CAP129n_Register reg, byte *buffer, byte len)
+int CAP129n::readRegisters(CAP129n_Register reg, byte *buffer, byte len)
 {
-    _i2cPort->beginTransmission(_deviceAddress);
-    _i2cPort->write(reg);
-    _i2cPort->endTransmission(false);           // endTransmission but keep the connection active
-    _i2cPort->requestFrom(_deviceAddress, len); // Ask for bytes, once done, bus is released by default
+    CAP129N_TIME(_stats, STAT_OP_READ);
+    for (uint8_t attempt = 0;; attempt++)
+    {
+        unsigned long start = micros();
+        int status = readOnce(reg, buffer, len);
+        if (!countAttempt(status, attempt, micros() - start))
+            return _lastError;
+    }
+}
 
-    // Wait for data to come back
-    if (_i2cPort->available() == len)
+/* READ A BATCH
+    Several register reads in one transport call, retried and counted as a
+    single transfer
+*/
+int CAP129n::readBatch(const CAP129nRead *reads, uint8_t count)
+{
+    CAP129N_TIME(_stats, STAT_OP_READ);
+    for (uint8_t attempt = 0;; attempt++)
     {
-        // Iterate through data from buffer
-        for (int i = 0; i < len; i++)
-            buffer[i] = _i2cPort->read();
+        unsigned long start = micros();
+        int status = _transport->readBatch(_deviceAddress, reads, count);
+        if (!countAttempt(status, attempt, micros() - start))
+            return _lastError;
     }
 }
 
 /* WRITE TO A SINGLE REGISTER
     Wire a single btyte of data to a register in CAP129n
 */
-void CAP129n::writeRegister(CAP129n_Register reg, byte data)
+int CAP129n::writeRegister(CAP129n_Register reg, byte data)
 {
-    writeRegisters(reg, &data, 1);
+    return writeRegisters(reg, &data, 1);
 }
 
 /* WRITE TO MULTIPLE REGISTERS
     Write an array of "len" bytes ("buffer"), starting at register "reg,"
-    and auto-incementing to the next
+    and auto-incementing to the next. A write to a register whose cached
+    read-modify-write read just failed is dropped, it would be built on a
+    wrong value. A failed write leaves the shadow of the registers it
+    covered invalid.
 */
-void CAP129n::writeRegisters(CAP129n_Register reg, byte *buffer, byte len)
+int CAP129n::writeRegisters(CAP129n_Register reg, byte *buffer, byte len)
 {
-    _i2cPort->beginTransmission(_deviceAddress);
-    _i2cPort->write(reg);
-    for (int i = 0; i < len; i++)
-        _i2cPort->write(buffer[i]);
-    _i2cPort->endTransmission(); // Stop transmitting
-}
\ No newline at end of file
+    CAP129N_TIME(_stats, STAT_OP_WRITE);
+    int16_t failed = _failedRegister;
+    _failedRegister = -1;
+    if (failed >= reg && failed < reg + len)
+    {
+        _lastError = ERR_I2C_SKIPPED;
+        return _lastError;
+    }
+    for (uint8_t attempt = 0;; attempt++)
+    {
+        unsigned long start = micros();
+        int status = writeOnce(reg, buffer, len);
+        if (!countAttempt(status, attempt, micros() - start))
+            break;
+    }
+    if (_lastError == I2C_SUCCESS)
+    {
+        updateShadow(reg, buffer, len);
+    }
+    else
+    {
+        for (int i = 0; i < len; i++)
+        {
+            int8_t idx = shadowIndex(reg + i);
+            if (idx >= 0)
+                _shadowValid &= ~shadowBlock(idx);
+        }
+    }
+    return _lastError;
+}
+
+/* SINGLE ATTEMPTS
+    One transport call each, no retries, no counters
+*/
+int CAP129n::readOnce(CAP129n_Register reg, byte *buffer, byte len)
+{
+    return _transport->writeRead(_deviceAddress, reg, buffer, len);
+}
+
+int CAP129n::writeOnce(CAP129n_Register reg, const byte *buffer, byte len)
+{
+    return _transport->write(_deviceAddress, reg, buffer, len);
+}
+
+/* COUNT AN ATTEMPT
+    Counts one transfer attempt and sets the last error. Returns true if
+    it failed and the retry budget allows another attempt.
+*/
+bool CAP129n::countAttempt(int status, uint8_t attempt, unsigned long attemptMicros)
+{
+    _lastError = status;
+    if (attempt == 0)
+        _transferStats.transfers++;
+    else
+        _transferStats.retries++;
+    if (status == I2C_SUCCESS)
+        return false;
+
+    if (status == ERR_I2C_NACK)
+        _transferStats.nacks++;
+    else if (status == ERR_I2C_SHORT_READ)
+        _transferStats.shortReads++;
+    _transferStats.lostMicros += attemptMicros;
+    if (attempt >= _retries)
+    {
+        _transferStats.failures++;
+        return false;
+    }
+    return true;
+}
+
+/* TRANSFER ERRORS
+*/
+void CAP129n::setRetries(uint8_t retries)
+{
+    _retries = retries;
+}
+
+// Status of the last transfer, I2C_SUCCESS or ERR_I2C_*
+int CAP129n::getLastError()
+{
+    return _lastError;
+}
+
+const CAP129nTransferStats &CAP129n::getTransferStats()
+{
+    return _transferStats;
+}
+
+void CAP129n::resetTransferStats()
+{
+    memset(&_transferStats, 0, sizeof(_transferStats));
+}
+
+/* LATENCY STATS
+    Copies the histograms out, they are only updated from the sketch's
+    context so the copy is consistent
+*/
+bool CAP129n::getLatencyStats(CAP129nStats &snapshot)
+{
+#if CAP129N_INSTRUMENTATION
+    snapshot = _stats;
+    return true;
+#else
+    snapshot.reset();
+    return false;
+#endif
+}
+
+void CAP129n::resetLatencyStats()
+{
+#if CAP129N_INSTRUMENTATION
+    _stats.reset();
+#endif
+}
@@ -10,7 +10,11 @@
 #include <Arduino.h>
 #include <Wire.h>
 
+#include "CAP129n_settings.h"
 #include "CAP129n_registers.h"
+#include "CAP129n_events.h"
+#include "CAP129n_stats.h"
+#include "CAP129n_transport.h"
 
 //Default I2C address
 #define DEFAULT_I2C_ADDR 0x28
@@ -65,6 +69,29 @@
 #define ERR_WRONG_PROD_ID 2
 #define BEGIN_SUCCESS 0
 
+//Retries after a failed transfer, a call makes at most 1 + retries transfers
+#ifndef CAP129N_DEFAULT_RETRIES
+#define CAP129N_DEFAULT_RETRIES 2
+#endif
+
+//Power states
+#define POWER_ACTIVE 0
+#define POWER_STANDBY 1
+#define POWER_DEEP_SLEEP 2
+
+//Standby defaults, STANDBY_CONFIG is averaging, sample time and cycle time as in the datasheet
+#define STANDBY_CONFIG_DEFAULT 0x39
+#define STANDBY_THRESH_DEFAULT 0x40
+
+//Power button hold times, PWR_TIME and STBY_PWR_TIME in POWER_BUTTON_CONFIG
+#define POWER_BUTTON_TIME_280 0x00
+#define POWER_BUTTON_TIME_560 0x01
+#define POWER_BUTTON_TIME_1120 0x02
+#define POWER_BUTTON_TIME_2240 0x03
+
+#define POWER_BUTTON_PWR_EN 0x04
+#define POWER_BUTTON_STBY_PWR_EN 0x40
+
 //Pattern detection options
 #define MTP_MODE_SPECIFIC 1
 #define MTP_MODE_MINIMAL_TOUCHES 2
@@ -73,6 +100,31 @@
 #define MTP_TRESHOLD_25 2
 #define MTP_TRESHOLD_37_5 3
 #define MTP_TRESHOLD_100 4
+//Register shadow layout, one entry per writable register
+#define SHADOW_MAIN_CONTROL 0
+#define SHADOW_CONFIG_BLOCK 1		//SENSITIVITY_CONTROL..RECALIBRATION_CONFIG
+#define SHADOW_CONFIG_BLOCK_LEN 17
+#define SHADOW_THRESH_BLOCK 18		//SENSOR_1_INPUT_THRESH..SENSOR_INPUT_NOISE_THRESH
+#define SHADOW_THRESH_BLOCK_LEN 9
+#define SHADOW_STANDBY_BLOCK 27		//STANDBY_CHANNEL..CONFIG_2
+#define SHADOW_STANDBY_BLOCK_LEN 5
+#define SHADOW_POWER_BLOCK 32		//POWER_BUTTON..POWER_BUTTON_CONFIG
+#define SHADOW_POWER_BLOCK_LEN 2
+#define SHADOW_SIZE 34
+
+//Register shadow validity, one flag per block
+#define SHADOW_VALID_MAIN_CONTROL 0x01
+#define SHADOW_VALID_CONFIG 0x02
+#define SHADOW_VALID_THRESH 0x04
+#define SHADOW_VALID_STANDBY 0x08
+#define SHADOW_VALID_POWER 0x10
+#define SHADOW_VALID_ALL 0x1F
+
+#define MAIN_CONTROL_INT_MASK 0x01
+#define MAIN_CONTROL_DSLEEP_MASK 0x10
+#define MAIN_CONTROL_STBY_MASK 0x20
+#define RECALIBRATION_BUT_LD_TH 0x80	//Writing the input 1 threshold updates all inputs
+
 // Sensitivity Control Register
 typedef union {
   struct
@@ -286,6 +338,35 @@ typedef union {
 } SIGNAL_GUARD_ENABLE_REG;
 
 
+// Transfer counters since the last resetTransferStats()
+struct CAP129nTransferStats
+{
+  unsigned long transfers;
+  unsigned long nacks;
+  unsigned long shortReads;
+  unsigned long retries;
+  unsigned long failures;	//Transfers that failed after every retry
+  unsigned long lostMicros;	//Time spent in failed attempts
+};
+
+// Status snapshot, MAIN_CONTROL..SENSOR_INPUT_STATUS captured by CAP129n::poll()
+struct TouchSnapshot
+{
+  uint8_t mainControl;
+  uint8_t generalStatus;
+  uint8_t inputStatus;
+  uint8_t noiseFlags;		//0 unless noise capture is enabled
+
+  bool isTouched(uint8_t id) const;
+  bool isTouched() const;
+  bool isMTPTouched() const;
+  bool isPowerButton() const;
+  bool isNoisy(uint8_t id) const;
+};
+
+// Configuration profile, see CAP129n_profile.h
+class CAP129nConfig;
+
 //Class declaration
 
 class CAP129n
@@ -295,6 +376,11 @@ public:
   CAP129n(uint8_t specifiedModel, byte addr = DEFAULT_I2C_ADDR);
   
   int begin(TwoWire &wirePort = Wire, uint8_t deviceAddress = DEFAULT_I2C_ADDR, uint8_t sensitivity = SENSITIVITY_32X, bool interrupts = true, bool sgEnable = false);  
+  int beginFast(const CAP129nConfig &config, TwoWire &wirePort = Wire, uint8_t deviceAddress = DEFAULT_I2C_ADDR);
+  // Same, over any CAP129nTransport, which must outlive this object
+  int begin(CAP129nTransport &transport, uint8_t deviceAddress = DEFAULT_I2C_ADDR, uint8_t sensitivity = SENSITIVITY_32X, bool interrupts = true, bool sgEnable = false);
+  int beginFast(const CAP129nConfig &config, CAP129nTransport &transport, uint8_t deviceAddress = DEFAULT_I2C_ADDR);
+  unsigned long getStartupTime();
   bool isConnected();
   void setSensitivity(uint8_t sensitivity);
   uint8_t getSensitivity();
@@ -303,6 +389,20 @@ public:
   bool isTouched(uint8_t id);
   bool isTouched();
   bool isMTPTouched();
+  
+  // Reads all status registers and clears INT, per-channel queries are then answered from RAM
+  const TouchSnapshot &poll();
+  // Status and the delta counts of every input in one batched read
+  const TouchSnapshot &poll(int8_t deltas[8]);
+  const TouchSnapshot &getSnapshot();
+  
+  // Event mode, press/release edges are queued by service() and drained with readEvent()
+  void setAlertMode(bool enabled);
+  void handleAlert();	//Call from the ALERT pin ISR
+  uint8_t service();
+  bool readEvent(TouchEvent &event);
+  uint8_t eventsAvailable();
+  unsigned long getEventOverflows();
 
 //-----BEGIN CONFIGURATION FUNCTIONS-----
   void enableSMBusTimeout();
@@ -312,6 +412,12 @@ public:
   void disableMaximumHoldDuration();
   void enableRFNoiseFilter();
   void disableRFNoiseFilter();
+  void enableAnalogNoiseFilter();
+  void disableAnalogNoiseFilter();
+  void enableDigitalNoiseFilter();
+  void disableDigitalNoiseFilter();
+  void enableRFNoiseOnly();	//Noise flags report RF noise only, EMI still blocks touches
+  void disableRFNoiseOnly();
   
   void enableMultipleTouchLimit();
   void disableMultipleTouchLimit();
@@ -337,6 +443,13 @@ public:
   // Clears INT bit
   void clearInterrupt();
   
+  // Writes only the registers that differ from the shadow, one burst per block
+  uint8_t apply(const CAP129nConfig &config, bool force = false);
+  
+  // Register shadow, resync() after an external reset of the chip
+  void invalidate();
+  void resync();
+  
   //Signal guard
   void enableSignalGuard();
   void disableSignalGuard();
@@ -351,26 +464,125 @@ public:
   void setInterruptEnabled();
   //bool isInterruptEnabled();
   
+  // Noise diagnostics, capture extends the poll() burst to NOISE_FLAG_STATUS
+  void setNoiseCapture(bool enabled);
+  unsigned long getNoiseCount(uint8_t id);
+  uint8_t getNoiseRate(uint8_t id);	//Percent of captured polls with the input flagged
+  unsigned long getDiscardedSamples();
+  unsigned long getNoiseCaptures();
+  void resetNoiseStats();
+  
+  // Power management, the chip keeps its active configuration in standby and deep sleep
+  void enterStandby(uint8_t wakeMask, uint8_t sensitivity = SENSITIVITY_32X, uint8_t threshold = STANDBY_THRESH_DEFAULT, uint8_t standbyConfig = STANDBY_CONFIG_DEFAULT);
+  void enterDeepSleep();
+  void wake();
+  uint8_t getPowerState();
+  unsigned long getWakeLatency();
+  
+  // Power button, the chip times the hold and sets PWR in the general status
+  void setPowerButton(uint8_t id, uint8_t activeTime = POWER_BUTTON_TIME_1120, uint8_t standbyTime = POWER_BUTTON_TIME_1120, bool activeEnabled = true, bool standbyEnabled = true);
+  void disablePowerButton();
+  uint8_t getPowerButton();
+  
+  // Per-input touch thresholds (7 bit) and the noise threshold (2 bit)
+  void setThresholds(const uint8_t thresholds[8], uint8_t noiseThreshold);
+  int readThresholds(uint8_t thresholds[8], uint8_t &noiseThreshold);
+  void setThreshold(uint8_t id, uint8_t threshold);
+  uint8_t getThreshold(uint8_t id);
+  void setNoiseThreshold(uint8_t threshold);
+  
+  // Channel masks, bit 0 is CS1, each call is a single register write
+  void setSensingMask(uint8_t mask);
+  uint8_t getSensingMask();
+  void setInterruptMask(uint8_t mask);
+  uint8_t getInterruptMask();
+  void setRepeatMask(uint8_t mask);
+  uint8_t getRepeatMask();
+  void setSignalGuardMask(uint8_t mask);
+  uint8_t getSignalGuardMask();
+  void calibrateMask(uint8_t mask);
+  uint8_t getCalibratingMask();
+  
   void checkMainControl();
   void checkStatus();
   
 
+  // Raw signal, one burst per call, returns the number of channels filled in (0 on a failed read)
+  uint8_t getChannelCount();
+  uint8_t readDeltaCounts(int8_t out[8]);
+  uint8_t readBaseCounts(uint8_t out[8]);
+
   uint8_t getInputStatus();  //dodano VM
   uint8_t getGeneralStatus();  //dodano VM
   uint8_t getMainControl();  //dodano VM
   byte readRegister(CAP129n_Register reg);
+  
+  // Transfer errors, a failed transfer is retried up to "retries" times
+  void setRetries(uint8_t retries);
+  int getLastError();
+  const CAP129nTransferStats &getTransferStats();
+  void resetTransferStats();
+  
+  // Latency histograms, false and empty unless CAP129N_INSTRUMENTATION is set in CAP129n_settings.h
+  bool getLatencyStats(CAP129nStats &snapshot);
+  void resetLatencyStats();
+
+  protected:
+  static uint8_t channelMask(uint8_t id);
+  int updateRegisterBits(CAP129n_Register reg, uint8_t mask, uint8_t bits);
+  byte readCachedRegister(CAP129n_Register reg);
+  byte readForUpdate(CAP129n_Register reg);
+  int writeRegister(CAP129n_Register reg, byte data);
 
   private:
-  TwoWire *_i2cPort = NULL; //The generic connection to user's chosen I2C hardware
+  friend class CAP129nAsync;
+  friend class CAP129nLogger;	//Raw bursts of the status block
+  
+  CAP129nTransport *_transport = NULL; //The generic connection to user's chosen I2C hardware
+  CAP129nWireTransport _wireTransport;	//Used by the TwoWire begin functions
   uint8_t _deviceAddress;   //Keeps track of I2C address. 
   uint8_t _specifiedModel;
   bool _singalGuardEnabled = false;
+  byte _shadow[SHADOW_SIZE];	//Copy of the writable registers, kept current on every write
+  uint8_t _shadowValid = 0x00;	//SHADOW_VALID_* flags
+  unsigned long _startupMicros = 0;
+  unsigned long _wakeMicros = 0;
+  unsigned long _wakeLatency = 0;
+  bool _wakePending = false;
+  TouchSnapshot _snapshot = {0x00, 0x00, 0x00, 0x00};
+  bool _noiseCapture = false;
+  unsigned long _noiseCounts[8] = {0};
+  unsigned long _noiseCaptures = 0;
+  
+  CAP129nEventQueue _events;
+  uint8_t _lastInputStatus = 0x00;
+  bool _lastPowerButton = false;
+  bool _alertMode = false;
+  volatile bool _alertPending = false;
+  volatile unsigned long _alertMicros = 0;
+  
+  uint8_t _retries = CAP129N_DEFAULT_RETRIES;
+  int _lastError = I2C_SUCCESS;
+  int16_t _failedRegister = -1;	//Register of a failed read-modify-write read, cleared by the next write
+  CAP129nTransferStats _transferStats = {0, 0, 0, 0, 0, 0};
+#if CAP129N_INSTRUMENTATION
+  CAP129nStats _stats;
+#endif
 
   // Read and write to registers
   
-  void readRegisters(CAP129n_Register reg, byte *buffer, byte len);
-  void writeRegister(CAP129n_Register reg, byte data);
-  void writeRegisters(CAP129n_Register reg, byte *buffer, byte len);
+  uint8_t pollLength();
+  bool storeSnapshot(const byte *buffer, uint8_t len);
+  int8_t shadowIndex(uint8_t reg);
+  uint8_t shadowBlock(uint8_t idx);
+  void updateShadow(CAP129n_Register reg, const byte *buffer, byte len);
+  bool applyBurst(const CAP129nConfig &config, bool force, uint8_t &block, uint8_t &offset);
+  int readRegisters(CAP129n_Register reg, byte *buffer, byte len);
+  int writeRegisters(CAP129n_Register reg, byte *buffer, byte len);
+  int readBatch(const CAP129nRead *reads, uint8_t count);
+  int readOnce(CAP129n_Register reg, byte *buffer, byte len);
+  int writeOnce(CAP129n_Register reg, const byte *buffer, byte len);
+  bool countAttempt(int status, uint8_t attempt, unsigned long attemptMicros);
   
 };
   
@@ -0,0 +1,236 @@
+/*
+ *	This file contains the implementation of the non-blocking CAP129n
+ *	front-end.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n_registers.h"
+#include "CAP129n.h"
+#include "CAP129n_async.h"
+#include "CAP129n_profile.h"
+
+#define ASYNC_QUEUE_MASK (CAP129N_ASYNC_QUEUE_SIZE - 1)
+
+CAP129nAsync::CAP129nAsync(CAP129n &device){
+	_device = &device;
+}
+
+uint16_t CAP129nAsync::poll(CAP129nAsyncCallback callback, void *context)
+{
+    CAP129nAsyncOp *op = enqueue(ASYNC_OP_POLL, callback, context);
+    if (op == NULL)
+        return ASYNC_QUEUE_FULL;
+    op->reg = MAIN_CONTROL;
+    op->len = _device->pollLength();
+    memset(op->data, 0, op->len);
+    return op->handle;
+}
+
+uint16_t CAP129nAsync::read(CAP129n_Register reg, byte *dest, uint8_t len, CAP129nAsyncCallback callback, void *context)
+{
+    CAP129nAsyncOp *op = enqueue(ASYNC_OP_READ, callback, context);
+    if (op == NULL)
+        return ASYNC_QUEUE_FULL;
+    op->reg = reg;
+    op->len = len;
+    op->dest = dest;
+    return op->handle;
+}
+
+uint16_t CAP129nAsync::write(CAP129n_Register reg, const byte *data, uint8_t len, CAP129nAsyncCallback callback, void *context)
+{
+    if (len > CAP129N_ASYNC_MAX_DATA)
+        return ASYNC_QUEUE_FULL;
+    CAP129nAsyncOp *op = enqueue(ASYNC_OP_WRITE, callback, context);
+    if (op == NULL)
+        return ASYNC_QUEUE_FULL;
+    op->reg = reg;
+    op->len = len;
+    memcpy(op->data, data, len);
+    return op->handle;
+}
+
+/*
+ *	Starts calibration of the inputs in "mask" and completes once the chip
+ *	has cleared all of their calibration bits.
+ */
+uint16_t CAP129nAsync::calibrate(uint8_t mask, CAP129nAsyncCallback callback, void *context)
+{
+    CAP129nAsyncOp *op = enqueue(ASYNC_OP_CALIBRATE, callback, context);
+    if (op == NULL)
+        return ASYNC_QUEUE_FULL;
+    op->reg = CALIBRATION_ACTIVATE_AND_STATUS;
+    op->len = 1;
+    op->data[0] = mask;
+    return op->handle;
+}
+
+/*
+ *	Starts a profile write, see CAP129n::apply(). Each step writes one
+ *	burst, diffed against the shadow when that step runs.
+ */
+uint16_t CAP129nAsync::apply(const CAP129nConfig &config, bool force, CAP129nAsyncCallback callback, void *context)
+{
+    CAP129nAsyncOp *op = enqueue(ASYNC_OP_APPLY, callback, context);
+    if (op == NULL)
+        return ASYNC_QUEUE_FULL;
+    op->reg = 0;
+    op->config = &config;
+    op->force = force;
+    return op->handle;
+}
+
+/*
+ *	Moves the oldest queued operation forward by one step. The device's
+ *	own retries are turned off for the step, so it is one I2C transaction
+ *	at most, and a failed step is attempted again on later calls instead.
+ */
+bool CAP129nAsync::service()
+{
+    if (_tail == _head)
+        return false;
+    CAP129nAsyncOp *op = &_ops[_tail];
+
+    uint8_t retries = _device->_retries;
+    _device->_retries = 0;
+    int result = step(op);
+    _device->_retries = retries;
+
+    if (result == ASYNC_PENDING)
+    {
+        op->attempts = 0;
+    }
+    else if (result != I2C_SUCCESS && result != ERR_I2C_SKIPPED && result != ASYNC_TIMEOUT && op->attempts < retries)
+    {
+        op->attempts++;
+    }
+    else
+    {
+        complete(op, result);
+    }
+    return _tail != _head;
+}
+
+/*
+ *	One step of "op". Returns ASYNC_PENDING when the operation goes on,
+ *	otherwise the result of the step, which ends it unless it is a
+ *	failure that may be retried.
+ */
+int CAP129nAsync::step(CAP129nAsyncOp *op)
+{
+    int result;
+    byte calibrating;
+    switch (op->type)
+    {
+    case ASYNC_OP_POLL:
+        if (op->step == 0)
+        {
+            result = _device->readRegisters(MAIN_CONTROL, op->data, op->len);
+            if (result == I2C_SUCCESS && _device->storeSnapshot(op->data, op->len))
+            {
+                op->step++;
+                return ASYNC_PENDING;	//INT set, clear it on the next call
+            }
+            return result;
+        }
+        return _device->writeRegister(MAIN_CONTROL, op->data[MAIN_CONTROL] & ~MAIN_CONTROL_INT_MASK);
+
+    case ASYNC_OP_READ:
+        return _device->readRegisters((CAP129n_Register)op->reg, op->dest, op->len);
+
+    case ASYNC_OP_WRITE:
+        return _device->writeRegisters((CAP129n_Register)op->reg, op->data, op->len);
+
+    case ASYNC_OP_CALIBRATE:
+        if (op->step == 0)
+        {
+            result = _device->writeRegister(CALIBRATION_ACTIVATE_AND_STATUS, op->data[0]);
+            if (result != I2C_SUCCESS)
+                return result;
+            op->step++;
+            op->started = micros();
+            op->due = op->started + CAP129N_ASYNC_CAL_CHECK_US;
+            return ASYNC_PENDING;
+        }
+        if ((long)(micros() - op->due) < 0)
+            return ASYNC_PENDING;
+        calibrating = _device->readRegister(CALIBRATION_ACTIVATE_AND_STATUS) & op->data[0];
+        result = _device->getLastError();
+        if (result != I2C_SUCCESS)
+            return result;
+        if (calibrating == 0x00)
+            return I2C_SUCCESS;
+        if (micros() - op->started >= CAP129N_ASYNC_CAL_TIMEOUT_US)
+            return ASYNC_TIMEOUT;
+        op->due = micros() + CAP129N_ASYNC_CAL_CHECK_US;
+        return ASYNC_PENDING;
+
+    case ASYNC_OP_APPLY:
+        if (!_device->applyBurst(*op->config, op->force, op->step, op->reg))
+            return I2C_SUCCESS;
+        result = _device->getLastError();
+        return result == I2C_SUCCESS ? ASYNC_PENDING : result;
+
+    default:
+        return I2C_SUCCESS;
+    }
+}
+
+bool CAP129nAsync::isDone(uint16_t handle)
+{
+    if (handle == ASYNC_QUEUE_FULL)
+        return false;
+    return (uint16_t)(_completed - handle) < 0x8000;
+}
+
+int CAP129nAsync::status(uint16_t handle)
+{
+    if (handle == ASYNC_QUEUE_FULL)
+        return ASYNC_REJECTED;
+    if (!isDone(handle))
+        return ASYNC_PENDING;
+    if ((uint16_t)(_completed - handle) >= CAP129N_ASYNC_QUEUE_SIZE)
+        return ASYNC_EXPIRED;
+    return _results[handle & ASYNC_QUEUE_MASK];
+}
+
+bool CAP129nAsync::isIdle()
+{
+    return _tail == _head;
+}
+
+CAP129nAsyncOp *CAP129nAsync::enqueue(uint8_t type, CAP129nAsyncCallback callback, void *context)
+{
+    uint8_t next = (_head + 1) & ASYNC_QUEUE_MASK;
+    if (next == _tail)
+        return NULL;
+    CAP129nAsyncOp *op = &_ops[_head];
+    _submitted++;
+    if (_submitted == ASYNC_QUEUE_FULL)
+        _submitted++;
+    op->handle = _submitted;
+    op->type = type;
+    op->step = 0;
+    op->attempts = 0;
+    op->dest = NULL;
+    op->callback = callback;
+    op->context = context;
+    _head = next;
+    return op;
+}
+
+void CAP129nAsync::complete(CAP129nAsyncOp *op, int status)
+{
+    // Copy out first, the callback may queue into the slot being freed
+    uint16_t handle = op->handle;
+    uint8_t type = op->type;
+    CAP129nAsyncCallback callback = op->callback;
+    void *context = op->context;
+
+    _results[handle & ASYNC_QUEUE_MASK] = status;
+    _completed = handle;
+    _tail = (_tail + 1) & ASYNC_QUEUE_MASK;
+    if (callback != NULL)
+        callback(handle, type, status, context);
+}
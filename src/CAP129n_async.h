@@ -0,0 +1,109 @@
+/*
+ *	Non-blocking front-end of the CAP1293/6/8 library. Operations are
+ *	queued and moved forward by service(), which performs at most one I2C
+ *	transaction per call, so the caller's worst-case stall is a single
+ *	transfer instead of a whole sequence. A failed step is attempted again
+ *	on the next calls, up to the device's setRetries() count.
+ */
+
+#ifndef __CAP129n_async_H__
+#define __CAP129n_async_H__
+
+#include <Arduino.h>
+
+#include "CAP129n_registers.h"
+#include "CAP129n.h"
+#include "CAP129n_profile.h"
+
+//Pending operations, must be a power of two
+#ifndef CAP129N_ASYNC_QUEUE_SIZE
+#define CAP129N_ASYNC_QUEUE_SIZE 4
+#endif
+
+static_assert(CAP129N_ASYNC_QUEUE_SIZE > 0 && (CAP129N_ASYNC_QUEUE_SIZE & (CAP129N_ASYNC_QUEUE_SIZE - 1)) == 0 && CAP129N_ASYNC_QUEUE_SIZE <= 256,
+              "CAP129N_ASYNC_QUEUE_SIZE must be a power of two, at most 256");
+
+//Largest burst a single write operation can carry (SENSITIVITY_CONTROL..RECALIBRATION_CONFIG)
+#define CAP129N_ASYNC_MAX_DATA 17
+
+//Time between calibration status checks, us
+#define CAP129N_ASYNC_CAL_CHECK_US 10000UL
+
+//Calibration still running this long after its start ends with ASYNC_TIMEOUT, us
+#ifndef CAP129N_ASYNC_CAL_TIMEOUT_US
+#define CAP129N_ASYNC_CAL_TIMEOUT_US 1000000UL
+#endif
+
+//Returned instead of a handle when the queue is full, never reports done
+#define ASYNC_QUEUE_FULL 0
+
+//status() besides I2C_SUCCESS and ERR_I2C_*
+#define ASYNC_PENDING -1	//Queued or running
+#define ASYNC_REJECTED -2	//ASYNC_QUEUE_FULL, nothing was queued
+#define ASYNC_EXPIRED -3	//Finished too long ago, the result is no longer kept
+#define ASYNC_TIMEOUT -4	//Calibration bits still set after CAP129N_ASYNC_CAL_TIMEOUT_US
+
+//Operation types
+#define ASYNC_OP_POLL 1
+#define ASYNC_OP_READ 2
+#define ASYNC_OP_WRITE 3
+#define ASYNC_OP_CALIBRATE 4
+#define ASYNC_OP_APPLY 5
+
+// "status" is I2C_SUCCESS, the ERR_I2C_* the operation stopped on or ASYNC_TIMEOUT
+typedef void (*CAP129nAsyncCallback)(uint16_t handle, uint8_t type, int status, void *context);
+
+struct CAP129nAsyncOp
+{
+  uint16_t handle;
+  uint8_t type;
+  uint8_t step;			//Apply: block
+  uint8_t attempts;		//Failed attempts of the current step
+  uint8_t reg;			//Apply: offset in the block
+  uint8_t len;
+  byte data[CAP129N_ASYNC_MAX_DATA];
+  byte *dest;
+  const CAP129nConfig *config;
+  bool force;
+  unsigned long started;
+  unsigned long due;
+  CAP129nAsyncCallback callback;
+  void *context;
+};
+
+class CAP129nAsync
+{
+public:
+  CAP129nAsync(CAP129n &device);
+  
+  // Queue an operation, returns its handle or ASYNC_QUEUE_FULL
+  uint16_t poll(CAP129nAsyncCallback callback = NULL, void *context = NULL);
+  uint16_t read(CAP129n_Register reg, byte *dest, uint8_t len, CAP129nAsyncCallback callback = NULL, void *context = NULL);
+  uint16_t write(CAP129n_Register reg, const byte *data, uint8_t len, CAP129nAsyncCallback callback = NULL, void *context = NULL);
+  uint16_t calibrate(uint8_t mask, CAP129nAsyncCallback callback = NULL, void *context = NULL);
+  // One diffed burst per step, "config" must stay valid until the operation is done
+  uint16_t apply(const CAP129nConfig &config, bool force = false, CAP129nAsyncCallback callback = NULL, void *context = NULL);
+  
+  // Runs at most one I2C transaction, returns true while work is pending
+  bool service();
+  
+  bool isDone(uint16_t handle);
+  // Result of a finished operation, kept for the last CAP129N_ASYNC_QUEUE_SIZE of them
+  int status(uint16_t handle);
+  bool isIdle();
+
+private:
+  CAP129nAsyncOp *enqueue(uint8_t type, CAP129nAsyncCallback callback, void *context);
+  int step(CAP129nAsyncOp *op);
+  void complete(CAP129nAsyncOp *op, int status);
+  
+  CAP129n *_device;
+  CAP129nAsyncOp _ops[CAP129N_ASYNC_QUEUE_SIZE];
+  uint8_t _head = 0;
+  uint8_t _tail = 0;
+  uint16_t _submitted = 0;	//Handle of the most recently queued operation
+  uint16_t _completed = 0;	//Handle of the most recently finished operation
+  int _results[CAP129N_ASYNC_QUEUE_SIZE];	//By handle, of the most recently finished operations
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ *	This file contains the implementation of the CAP129n bus manager.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_bus.h"
+
+int8_t CAP129nBus::addDevice(CAP129n &device)
+{
+    if (_deviceCount >= CAP129N_BUS_MAX_DEVICES)
+        return ERR_BUS_FULL;
+    _devices[_deviceCount] = &device;
+    return _deviceCount++;
+}
+
+uint8_t CAP129nBus::getDeviceCount()
+{
+    return _deviceCount;
+}
+
+CAP129n *CAP129nBus::getDevice(uint8_t index)
+{
+    if (index >= _deviceCount)
+        return NULL;
+    return _devices[index];
+}
+
+/*
+ *	Services every device back to back, starting with a different one each
+ *	pass, and moves their events into the merged queue. At most one
+ *	scheduled job runs per pass so configuration never stalls all devices
+ *	at once.
+ */
+uint8_t CAP129nBus::service()
+{
+    uint8_t queued = 0;
+    TouchEvent event;
+
+    for (uint8_t n = 0; n < _deviceCount; n++)
+    {
+        uint8_t index = (_first + n) % _deviceCount;
+        CAP129n *device = _devices[index];
+        device->service();
+        while (device->readEvent(event))
+        {
+            event.device = index;
+            if (_events.push(event))
+                queued++;
+        }
+    }
+    if (_deviceCount > 0)
+        _first = (_first + 1) % _deviceCount;
+
+    if (_jobPending)
+    {
+        uint8_t index = 0;
+        while (!(_jobPending & ((CAP129nDeviceMask)1 << index)))
+            index++;
+        _jobPending &= ~((CAP129nDeviceMask)1 << index);
+        if (index < _deviceCount)
+            _job(*_devices[index], _jobContext);
+    }
+    return queued;
+}
+
+bool CAP129nBus::readEvent(TouchEvent &event)
+{
+    return _events.pop(event);
+}
+
+uint8_t CAP129nBus::eventsAvailable()
+{
+    return _events.available();
+}
+
+unsigned long CAP129nBus::getEventOverflows()
+{
+    return _events.getOverflows();
+}
+
+/*
+ *	Returns false if a previous job is still running.
+ */
+bool CAP129nBus::schedule(CAP129nDeviceMask deviceMask, CAP129nBusJob job, void *context)
+{
+    if (_jobPending || job == NULL)
+        return false;
+    _job = job;
+    _jobContext = context;
+    _jobPending = deviceMask;
+    return true;
+}
+
+static void calibrateJob(CAP129n &device, void *context)
+{
+    (void)context;
+    device.calibrateAll();
+}
+
+bool CAP129nBus::calibrateAll()
+{
+    if (_deviceCount == 0)
+        return false;
+    return schedule((CAP129nDeviceMask)~(CAP129nDeviceMask)0 >> (sizeof(CAP129nDeviceMask) * 8 - _deviceCount), calibrateJob);
+}
+
+bool CAP129nBus::isBusy()
+{
+    return _jobPending != 0;
+}
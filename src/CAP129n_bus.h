@@ -0,0 +1,65 @@
+/*
+ *	Manager for several CAP1293/6/8 parts sharing one I2C bus. Status reads
+ *	of all devices run back to back in one pass and their touch events are
+ *	merged into a single queue tagged with the device index. Scheduled
+ *	work (calibration, configuration) is spread one device per pass.
+ */
+
+#ifndef __CAP129n_bus_H__
+#define __CAP129n_bus_H__
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_events.h"
+
+#ifndef CAP129N_BUS_MAX_DEVICES
+#define CAP129N_BUS_MAX_DEVICES 8
+#endif
+
+static_assert(CAP129N_BUS_MAX_DEVICES >= 1 && CAP129N_BUS_MAX_DEVICES <= 32, "CAP129N_BUS_MAX_DEVICES must be 1..32");
+
+//One bit per device index, as narrow as CAP129N_BUS_MAX_DEVICES allows
+#if CAP129N_BUS_MAX_DEVICES > 16
+typedef uint32_t CAP129nDeviceMask;
+#elif CAP129N_BUS_MAX_DEVICES > 8
+typedef uint16_t CAP129nDeviceMask;
+#else
+typedef uint8_t CAP129nDeviceMask;
+#endif
+
+#define ERR_BUS_FULL -1
+
+typedef void (*CAP129nBusJob)(CAP129n &device, void *context);
+
+class CAP129nBus
+{
+public:
+  // Returns the device index or ERR_BUS_FULL
+  int8_t addDevice(CAP129n &device);
+  uint8_t getDeviceCount();
+  CAP129n *getDevice(uint8_t index);
+  
+  // One pass over all devices, returns the number of events queued
+  uint8_t service();
+  bool readEvent(TouchEvent &event);
+  uint8_t eventsAvailable();
+  unsigned long getEventOverflows();
+  
+  // Runs "job" on every device in "deviceMask", one device per service() pass
+  bool schedule(CAP129nDeviceMask deviceMask, CAP129nBusJob job, void *context = NULL);
+  bool calibrateAll();
+  bool isBusy();
+
+private:
+  CAP129n *_devices[CAP129N_BUS_MAX_DEVICES];
+  uint8_t _deviceCount = 0;
+  uint8_t _first = 0;		//Device polled first in the next pass, rotates for fairness
+  CAP129nEventQueue _events;
+  
+  CAP129nBusJob _job = NULL;
+  void *_jobContext = NULL;
+  CAP129nDeviceMask _jobPending = 0;	//Devices the job still has to run on
+};
+
+#endif
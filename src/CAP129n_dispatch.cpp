@@ -0,0 +1,149 @@
+/*
+ *	This file contains the implementation of the CAP129n callback
+ *	dispatcher.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_dispatch.h"
+#include "CAP129n_gestures.h"
+
+#define ROUTE_PRESS 0
+#define ROUTE_RELEASE 1
+#define ROUTE_HOLD 2
+
+CAP129nDispatcher::CAP129nDispatcher(){
+	_used = 0x00;
+	_added = 0x00;
+	memset(_routes, 0, sizeof(_routes));
+	setHoldTime(DISPATCH_HOLD_MS);
+	reset();
+}
+
+int8_t CAP129nDispatcher::on(uint8_t mask, uint8_t type, CAP129nTouchHandler handler, void *context){
+	if (handler == NULL || mask == 0x00 || route(type) < 0)
+		return ERR_DISPATCH_INVALID;
+	for (uint8_t slot = 0; slot < CAP129N_DISPATCH_HANDLERS; slot++)
+	{
+		if (_used & (1 << slot))
+			continue;
+		_entries[slot].mask = mask;
+		_entries[slot].type = type;
+		_entries[slot].handler = handler;
+		_entries[slot].context = context;
+		_used |= 1 << slot;
+		_added |= 1 << slot;
+		rebuildRoutes();
+		return slot;
+	}
+	return ERR_DISPATCH_FULL;
+}
+
+int8_t CAP129nDispatcher::onChannel(uint8_t id, uint8_t type, CAP129nTouchHandler handler, void *context){
+	if (id < 1 || id > 8)
+		return ERR_DISPATCH_INVALID;
+	return on(1 << (id - 1), type, handler, context);
+}
+
+void CAP129nDispatcher::off(int8_t handle){
+	if (handle < 0 || handle >= CAP129N_DISPATCH_HANDLERS)
+		return;
+	_used &= ~(1 << handle);
+	rebuildRoutes();
+}
+
+void CAP129nDispatcher::setHoldTime(uint16_t holdMs){
+	_tracker.setHoldTime(holdMs * 1000UL);
+}
+
+void CAP129nDispatcher::reset(){
+	_tracker.reset();
+}
+
+uint8_t CAP129nDispatcher::update(CAP129n &device){
+	const TouchSnapshot &snapshot = device.poll();
+	if (device.getLastError() != I2C_SUCCESS)
+		return 0;
+	return update(snapshot.inputStatus, micros());
+}
+
+uint8_t CAP129nDispatcher::update(uint8_t status){
+	return update(status, micros());
+}
+
+/*
+ *	Edges and holds come from the tracker, only their set bits are
+ *	visited, lowest first.
+ */
+uint8_t CAP129nDispatcher::update(uint8_t status, unsigned long now){
+	uint8_t calls = 0;
+	_tracker.update(status, now);
+	uint8_t pressed = _tracker.getPressed();
+	uint8_t changed = pressed | _tracker.getReleased();
+	while (changed)
+	{
+		uint8_t index = __builtin_ctz(changed);
+		uint8_t bit = changed & -changed;
+		changed &= changed - 1;
+		calls += dispatch(index, (pressed & bit) ? TOUCH_EVENT_PRESS : TOUCH_EVENT_RELEASE);
+	}
+
+	uint8_t held = _tracker.getHeld();
+	while (held)
+	{
+		calls += dispatch(__builtin_ctz(held), TOUCH_EVENT_LONG_PRESS);
+		held &= held - 1;
+	}
+	return calls;
+}
+
+int8_t CAP129nDispatcher::route(uint8_t type){
+	switch (type)
+	{
+	case TOUCH_EVENT_PRESS:
+		return ROUTE_PRESS;
+	case TOUCH_EVENT_RELEASE:
+		return ROUTE_RELEASE;
+	case TOUCH_EVENT_LONG_PRESS:
+		return ROUTE_HOLD;
+	default:
+		return -1;
+	}
+}
+
+// Per type and input, the mask of table slots that want the event
+void CAP129nDispatcher::rebuildRoutes(){
+	memset(_routes, 0, sizeof(_routes));
+	for (uint8_t slot = 0; slot < CAP129N_DISPATCH_HANDLERS; slot++)
+	{
+		if (!(_used & (1 << slot)))
+			continue;
+		int8_t r = route(_entries[slot].type);
+		for (uint8_t i = 0; i < 8; i++)
+			if (_entries[slot].mask & (1 << i))
+				_routes[r][i] |= 1 << slot;
+	}
+}
+
+/*
+ *	A handler may call on() or off(), so the route is copied first and
+ *	every slot is checked again before its call. A slot freed and filled
+ *	again by a handler belongs to a new registration and waits for the
+ *	next event.
+ */
+uint8_t CAP129nDispatcher::dispatch(uint8_t index, uint8_t type){
+	uint8_t slots = _routes[route(type)][index];
+	uint8_t calls = 0;
+	_added = 0x00;
+	while (slots)
+	{
+		uint8_t slot = __builtin_ctz(slots);
+		slots &= slots - 1;
+		if (!(_used & ~_added & (1 << slot)))
+			continue;
+		_entries[slot].handler(index + 1, type, _entries[slot].context);
+		calls++;
+	}
+	return calls;
+}
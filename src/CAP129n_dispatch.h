@@ -0,0 +1,73 @@
+/*
+ *	Callback dispatch of the CAP1293/6/8 library. Handlers for press,
+ *	release and hold are registered per input or per mask in a fixed
+ *	table, no allocation. Each status sample costs one XOR and the work
+ *	after it is proportional to the inputs that changed or are held.
+ */
+
+#ifndef __CAP129n_dispatch_H__
+#define __CAP129n_dispatch_H__
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_events.h"
+#include "CAP129n_gestures.h"
+
+//Table size, at most 8
+#ifndef CAP129N_DISPATCH_HANDLERS
+#define CAP129N_DISPATCH_HANDLERS 8
+#endif
+
+static_assert(CAP129N_DISPATCH_HANDLERS >= 1 && CAP129N_DISPATCH_HANDLERS <= 8, "CAP129N_DISPATCH_HANDLERS must be 1..8, slots are tracked in uint8_t masks");
+
+#define ERR_DISPATCH_FULL -1
+#define ERR_DISPATCH_INVALID -2	//No handler, empty mask, input outside 1..8 or unsupported type
+
+//Default hold time, reported as TOUCH_EVENT_LONG_PRESS
+#define DISPATCH_HOLD_MS 800
+
+// "channel" is 1..8, "type" is TOUCH_EVENT_PRESS, TOUCH_EVENT_RELEASE or TOUCH_EVENT_LONG_PRESS
+typedef void (*CAP129nTouchHandler)(uint8_t channel, uint8_t type, void *context);
+
+class CAP129nDispatcher
+{
+public:
+  CAP129nDispatcher();
+
+  // Returns a handle for off(), ERR_DISPATCH_FULL or ERR_DISPATCH_INVALID
+  int8_t on(uint8_t mask, uint8_t type, CAP129nTouchHandler handler, void *context = NULL);
+  int8_t onChannel(uint8_t id, uint8_t type, CAP129nTouchHandler handler, void *context = NULL);
+  void off(int8_t handle);
+
+  // 0 disables hold
+  void setHoldTime(uint16_t holdMs);
+
+  // Feed one status sample, returns the number of handler calls
+  uint8_t update(CAP129n &device);	//One poll()
+  uint8_t update(uint8_t status);
+  uint8_t update(uint8_t status, unsigned long nowMicros);
+  void reset();
+
+private:
+  struct Entry
+  {
+    uint8_t mask;
+    uint8_t type;
+    CAP129nTouchHandler handler;
+    void *context;
+  };
+
+  static int8_t route(uint8_t type);
+  void rebuildRoutes();
+  uint8_t dispatch(uint8_t index, uint8_t type);
+
+  Entry _entries[CAP129N_DISPATCH_HANDLERS];
+  uint8_t _used;		//Occupied table slots
+  uint8_t _added;		//Slots filled by a handler during the current dispatch()
+  uint8_t _routes[3][8];	//Slots to call per type and input
+
+  CAP129nTouchTracker _tracker;	//Edges and the hold timer
+};
+
+#endif
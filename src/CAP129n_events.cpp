@@ -0,0 +1,50 @@
+/*
+ *	This file contains the implementation of the CAP129n touch event queue.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n_events.h"
+
+#define EVENT_QUEUE_MASK (CAP129N_EVENT_QUEUE_SIZE - 1)
+
+bool CAP129nEventQueue::push(const TouchEvent &event)
+{
+    uint8_t head = _head;
+    uint8_t next = (head + 1) & EVENT_QUEUE_MASK;
+    if (next == _tail)
+    {
+        _overflows++;
+        return false;
+    }
+    _buffer[head] = event;
+    CAP129N_BARRIER();
+    _head = next;
+    return true;
+}
+
+bool CAP129nEventQueue::pop(TouchEvent &event)
+{
+    uint8_t tail = _tail;
+    if (tail == _head)
+        return false;
+    event = _buffer[tail];
+    CAP129N_BARRIER();
+    _tail = (tail + 1) & EVENT_QUEUE_MASK;
+    return true;
+}
+
+uint8_t CAP129nEventQueue::available()
+{
+    return (_head - _tail) & EVENT_QUEUE_MASK;
+}
+
+unsigned long CAP129nEventQueue::getOverflows()
+{
+    return _overflows;
+}
+
+void CAP129nEventQueue::resetOverflows()
+{
+    _overflows = 0;
+}
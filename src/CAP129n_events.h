@@ -0,0 +1,60 @@
+/*
+ *	Touch event queue of the CAP1293/6/8 library. Fixed capacity, no
+ *	allocation, one producer (CAP129n::service) and one consumer (the
+ *	sketch's loop).
+ */
+
+#ifndef __CAP129n_events_H__
+#define __CAP129n_events_H__
+
+#include <Arduino.h>
+
+//Queue capacity, must be a power of two
+#ifndef CAP129N_EVENT_QUEUE_SIZE
+#define CAP129N_EVENT_QUEUE_SIZE 16
+#endif
+
+static_assert(CAP129N_EVENT_QUEUE_SIZE > 0 && (CAP129N_EVENT_QUEUE_SIZE & (CAP129N_EVENT_QUEUE_SIZE - 1)) == 0 && CAP129N_EVENT_QUEUE_SIZE <= 256,
+              "CAP129N_EVENT_QUEUE_SIZE must be a power of two, at most 256");
+
+//Event types
+#define TOUCH_EVENT_PRESS 1
+#define TOUCH_EVENT_RELEASE 2
+#define TOUCH_EVENT_TAP 3
+#define TOUCH_EVENT_DOUBLE_TAP 4
+#define TOUCH_EVENT_LONG_PRESS 5
+#define TOUCH_EVENT_HOLD_REPEAT 6
+#define TOUCH_EVENT_POWER_BUTTON 7	//Held for the POWER_BUTTON_CONFIG time, timed by the chip
+
+//Keeps the compiler from moving the slot write past the index update
+#define CAP129N_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+struct TouchEvent
+{
+  uint8_t device;		//Index on a CAP129nBus, 0 for a single device
+  uint8_t channel;		//1..8
+  uint8_t type;			//TOUCH_EVENT_*
+  unsigned long timestamp;	//micros()
+};
+
+class CAP129nEventQueue
+{
+public:
+  // Producer side, returns false and counts an overflow if the queue is full
+  bool push(const TouchEvent &event);
+  
+  // Consumer side, returns false if the queue is empty
+  bool pop(TouchEvent &event);
+  uint8_t available();
+  
+  unsigned long getOverflows();
+  void resetOverflows();
+
+private:
+  TouchEvent _buffer[CAP129N_EVENT_QUEUE_SIZE];
+  volatile uint8_t _head = 0;	//Written by the producer only
+  volatile uint8_t _tail = 0;	//Written by the consumer only
+  volatile unsigned long _overflows = 0;
+};
+
+#endif
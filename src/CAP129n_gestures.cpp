@@ -0,0 +1,207 @@
+/*
+ *	This file contains the implementation of the CAP129n gesture recognizer.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n_events.h"
+#include "CAP129n_gestures.h"
+
+//-----BEGIN TOUCH TRACKER-----
+
+CAP129nTouchTracker::CAP129nTouchTracker(){
+	_hold = 0;
+	reset();
+}
+
+void CAP129nTouchTracker::setHoldTime(unsigned long holdUs){
+	_hold = holdUs;
+}
+
+void CAP129nTouchTracker::reset(){
+	_last = 0x00;
+	_pressed = 0x00;
+	_released = 0x00;
+	_held = 0x00;
+	_holding = 0x00;
+}
+
+/*
+ *	Only the set bits of the XOR and of the held inputs still waiting for
+ *	their hold time are visited, lowest first.
+ */
+void CAP129nTouchTracker::update(uint8_t status, unsigned long now){
+	uint8_t changed = status ^ _last;
+	_pressed = changed & status;
+	_released = changed & _last;
+	_last = status;
+	_held = 0x00;
+	_holding &= ~_pressed;
+
+	uint8_t bits = _pressed;
+	while (bits)
+	{
+		_pressTime[__builtin_ctz(bits)] = now;
+		bits &= bits - 1;
+	}
+	if (_hold == 0)
+		return;
+
+	uint8_t waiting = status & ~_pressed & ~_holding;
+	while (waiting)
+	{
+		uint8_t index = __builtin_ctz(waiting);
+		uint8_t bit = waiting & -waiting;
+		waiting &= waiting - 1;
+		if (now - _pressTime[index] >= _hold)
+			_held |= bit;
+	}
+	_holding |= _held;
+}
+
+uint8_t CAP129nTouchTracker::getPressed(){
+	return _pressed;
+}
+
+uint8_t CAP129nTouchTracker::getReleased(){
+	return _released;
+}
+
+uint8_t CAP129nTouchTracker::getHeld(){
+	return _held;
+}
+
+uint8_t CAP129nTouchTracker::getHolding(){
+	return _holding;
+}
+
+unsigned long CAP129nTouchTracker::getPressTime(uint8_t index){
+	return index < 8 ? _pressTime[index] : 0;
+}
+
+//-----END TOUCH TRACKER-----
+
+CAP129nGestures::CAP129nGestures(){
+	setTimings(GESTURE_TAP_MAX_MS, GESTURE_DOUBLE_TAP_GAP_MS, GESTURE_LONG_PRESS_MS, GESTURE_HOLD_REPEAT_MS);
+	reset();
+}
+
+void CAP129nGestures::setTimings(uint16_t tapMaxMs, uint16_t doubleTapGapMs, uint16_t longPressMs, uint16_t holdRepeatMs){
+	_tapMax = tapMaxMs * 1000UL;
+	_doubleTapGap = doubleTapGapMs * 1000UL;
+	_tracker.setHoldTime(longPressMs * 1000UL);
+	_holdRepeat = holdRepeatMs * 1000UL;
+}
+
+void CAP129nGestures::reset(){
+	_tracker.reset();
+	_tapPending = 0x00;
+	_secondPress = 0x00;
+}
+
+uint8_t CAP129nGestures::update(uint8_t status){
+	return update(status, micros());
+}
+
+/*
+ *	A tap is a press released within the tap time that did not reach the
+ *	long press. A second press within the double-tap gap of the first
+ *	tap's release is a double tap if it is released as a tap too,
+ *	otherwise the first tap is reported on its own. Only inputs that
+ *	changed, reached or are past the long press, or wait for a second
+ *	press are visited.
+ */
+uint8_t CAP129nGestures::update(uint8_t status, unsigned long now){
+	_tracker.update(status, now);
+	uint8_t pressed = _tracker.getPressed();
+	uint8_t released = _tracker.getReleased();
+	uint8_t held = _tracker.getHeld();
+	uint8_t holding = _tracker.getHolding();
+	uint8_t repeating = _holdRepeat ? (status & holding & ~held) : 0x00;
+
+	uint8_t queued = 0;
+	uint8_t visit = pressed | released | held | repeating | _tapPending;
+	while (visit)
+	{
+		uint8_t i = __builtin_ctz(visit);
+		uint8_t bit = visit & -visit;
+		visit &= visit - 1;
+
+		if (pressed & bit)
+		{
+			if (_tapPending & bit)
+			{
+				_tapPending &= ~bit;
+				if (now - _markTime[i] <= _doubleTapGap)
+					_secondPress |= bit;
+				else
+					queued += emit(i, TOUCH_EVENT_TAP, _markTime[i]);
+			}
+		}
+		else if (released & bit)
+		{
+			bool tap = !(holding & bit) && now - _tracker.getPressTime(i) <= _tapMax;
+			if (_secondPress & bit)
+			{
+				_secondPress &= ~bit;
+				queued += emit(i, tap ? TOUCH_EVENT_DOUBLE_TAP : TOUCH_EVENT_TAP, tap ? now : _markTime[i]);
+			}
+			else if (tap && _doubleTapGap == 0)
+			{
+				queued += emit(i, TOUCH_EVENT_TAP, now);
+			}
+			else if (tap)
+			{
+				_tapPending |= bit;
+				_markTime[i] = now;
+			}
+		}
+		else if (held & bit)
+		{
+			if (_secondPress & bit)
+			{
+				// The second press became a long press, the first tap stands alone
+				_secondPress &= ~bit;
+				queued += emit(i, TOUCH_EVENT_TAP, _markTime[i]);
+			}
+			_markTime[i] = now;
+			queued += emit(i, TOUCH_EVENT_LONG_PRESS, now);
+		}
+		else if (repeating & bit)
+		{
+			if (now - _markTime[i] >= _holdRepeat)
+			{
+				_markTime[i] += _holdRepeat;
+				queued += emit(i, TOUCH_EVENT_HOLD_REPEAT, now);
+			}
+		}
+		else if (now - _markTime[i] > _doubleTapGap)
+		{
+			// No second press came in time
+			_tapPending &= ~bit;
+			queued += emit(i, TOUCH_EVENT_TAP, _markTime[i]);
+		}
+	}
+	return queued;
+}
+
+uint8_t CAP129nGestures::emit(uint8_t index, uint8_t type, unsigned long now){
+	TouchEvent event;
+	event.device = 0;
+	event.channel = index + 1;
+	event.type = type;
+	event.timestamp = now;
+	return _events.push(event) ? 1 : 0;
+}
+
+bool CAP129nGestures::readEvent(TouchEvent &event){
+	return _events.pop(event);
+}
+
+uint8_t CAP129nGestures::eventsAvailable(){
+	return _events.available();
+}
+
+unsigned long CAP129nGestures::getEventOverflows(){
+	return _events.getOverflows();
+}
@@ -0,0 +1,81 @@
+/*
+ *	Gesture recognizer of the CAP1293/6/8 library. Consumes successive
+ *	SENSOR_INPUT_STATUS bytes (for example CAP129n::poll().inputStatus)
+ *	and emits tap, double-tap, long-press and hold-repeat events. Edges of
+ *	all inputs are found with one XOR per sample, and the work after it is
+ *	proportional to the inputs that changed or have a timer running.
+ *	Memory use is fixed, no extra I2C traffic is needed.
+ */
+
+#ifndef __CAP129n_gestures_H__
+#define __CAP129n_gestures_H__
+
+#include <Arduino.h>
+
+#include "CAP129n_events.h"
+
+//Default timings in ms
+#define GESTURE_TAP_MAX_MS 250
+#define GESTURE_DOUBLE_TAP_GAP_MS 300	//First release to second press, 0 reports every tap immediately
+#define GESTURE_LONG_PRESS_MS 800
+#define GESTURE_HOLD_REPEAT_MS 200	//0 disables hold-repeat
+
+// Press and release edges of all inputs and a one-shot hold timer per press
+class CAP129nTouchTracker
+{
+public:
+  CAP129nTouchTracker();
+  
+  void setHoldTime(unsigned long holdUs);	//0 disables hold
+  void reset();
+  
+  // Feed one status sample, the masks below then describe it
+  void update(uint8_t status, unsigned long nowMicros);
+  uint8_t getPressed();		//Went down with this sample
+  uint8_t getReleased();	//Went up with this sample
+  uint8_t getHeld();		//Reached the hold time with this sample
+  uint8_t getHolding();		//Reached the hold time during the current or just released press
+  unsigned long getPressTime(uint8_t index);
+
+private:
+  unsigned long _hold;
+  uint8_t _last;		//Previous status sample
+  uint8_t _pressed;
+  uint8_t _released;
+  uint8_t _held;
+  uint8_t _holding;
+  unsigned long _pressTime[8];
+};
+
+class CAP129nGestures
+{
+public:
+  CAP129nGestures();
+  
+  void setTimings(uint16_t tapMaxMs, uint16_t doubleTapGapMs, uint16_t longPressMs, uint16_t holdRepeatMs);
+  
+  // Feed one status sample, returns the number of gesture events queued
+  uint8_t update(uint8_t status);
+  uint8_t update(uint8_t status, unsigned long nowMicros);
+  
+  bool readEvent(TouchEvent &event);
+  uint8_t eventsAvailable();
+  unsigned long getEventOverflows();
+  void reset();
+
+private:
+  uint8_t emit(uint8_t index, uint8_t type, unsigned long now);
+  
+  unsigned long _tapMax;		//All timings in us
+  unsigned long _doubleTapGap;
+  unsigned long _holdRepeat;
+  
+  CAP129nTouchTracker _tracker;	//Edges and the long-press timer
+  uint8_t _tapPending;		//Tapped inputs waiting for a possible second press
+  uint8_t _secondPress;		//Inputs pressed again within the gap, a double tap if released in time
+  unsigned long _markTime[8];	//First tap release, or last long-press/repeat, depending on state
+  
+  CAP129nEventQueue _events;
+};
+
+#endif
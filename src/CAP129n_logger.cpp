@@ -0,0 +1,147 @@
+/*
+ *	This file contains the implementation of the CAP129n raw signal logger.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n_registers.h"
+#include "CAP129n.h"
+#include "CAP129n_logger.h"
+
+//Offsets into the 0x02..0x17 burst
+#define SAMPLE_LENGTH (SENSOR_INPUT_8_DELTA_COUNT - GENERAL_STATUS + 1)
+#define SAMPLE_GENERAL (GENERAL_STATUS - GENERAL_STATUS)
+#define SAMPLE_INPUT (SENSOR_INPUT_STATUS - GENERAL_STATUS)
+#define SAMPLE_NOISE (NOISE_FLAG_STATUS - GENERAL_STATUS)
+#define SAMPLE_DELTA (SENSOR_INPUT_1_DELTA_COUNT - GENERAL_STATUS)
+
+CAP129nLogger::CAP129nLogger(CAP129n &device, unsigned long intervalMicros){
+	_device = &device;
+	_interval = intervalMicros;
+	_nextDue = micros();
+}
+
+void CAP129nLogger::setInterval(unsigned long intervalMicros){
+	_interval = intervalMicros;
+	_nextDue = micros();
+}
+
+/*
+ *	Samples are scheduled on a fixed grid so the rate does not drift. If
+ *	the caller fell more than one interval behind, the grid restarts from
+ *	now instead of bursting to catch up. Status bits latch until INT is
+ *	cleared, so INT is cleared whenever an input reads as touched; the
+ *	logger should be the only consumer of the device while it streams.
+ */
+bool CAP129nLogger::sample(){
+	unsigned long now = micros();
+	if ((long)(now - _nextDue) < 0)
+		return false;
+	_nextDue += _interval;
+	if ((long)(now - _nextDue) >= 0)
+		_nextDue = now + _interval;
+
+	byte buffer[SAMPLE_LENGTH] = {0};
+	if (_device->readRegisters(GENERAL_STATUS, buffer, SAMPLE_LENGTH) != I2C_SUCCESS)
+	{
+		_sequence++;	//No frame for a failed read, the decoder sees the gap
+		return false;
+	}
+	if (buffer[SAMPLE_INPUT])
+		_device->clearInterrupt();
+
+	CAP129nFrame frame;
+	frame.sequence = _sequence++;
+	frame.timestamp = now;
+	frame.generalStatus = buffer[SAMPLE_GENERAL];
+	frame.inputStatus = buffer[SAMPLE_INPUT];
+	frame.noiseFlags = buffer[SAMPLE_NOISE];
+	memcpy(frame.delta, &buffer[SAMPLE_DELTA], 8);
+
+	if (_count == CAP129N_LOGGER_FRAMES)
+	{
+		_dropped++;	//Read, but no room to keep it
+		return false;
+	}
+	encode(frame, _frames[_head]);
+	_head = (_head + 1) % CAP129N_LOGGER_FRAMES;
+	_count++;
+	return true;
+}
+
+size_t CAP129nLogger::flush(Print &out, size_t budget){
+	// A Print that does not report free space returns 0, then everything is written
+	if (budget == 0)
+		budget = out.availableForWrite();
+	if (budget == 0)
+		budget = (size_t)-1;
+
+	size_t written = 0;
+	while (_count > 0 && written < budget)
+	{
+		uint8_t tail = (_head + CAP129N_LOGGER_FRAMES - _count) % CAP129N_LOGGER_FRAMES;
+		size_t chunk = CAP129N_FRAME_SIZE - _outOffset;
+		if (chunk > budget - written)
+			chunk = budget - written;
+		size_t n = out.write(&_frames[tail][_outOffset], chunk);
+		written += n;
+		_outOffset += n;
+		if (_outOffset == CAP129N_FRAME_SIZE)
+		{
+			_outOffset = 0;
+			_count--;
+		}
+		if (n < chunk)
+			break;
+	}
+	return written;
+}
+
+uint8_t CAP129nLogger::framesBuffered(){
+	return _count;
+}
+
+unsigned long CAP129nLogger::getDroppedFrames(){
+	return _dropped;
+}
+
+void CAP129nLogger::encode(const CAP129nFrame &frame, byte *out){
+	out[0] = CAP129N_FRAME_SYNC_1;
+	out[1] = CAP129N_FRAME_SYNC_2;
+	out[2] = frame.sequence & 0xFF;
+	out[3] = frame.sequence >> 8;
+	for (uint8_t i = 0; i < 4; i++)
+		out[4 + i] = (frame.timestamp >> (8 * i)) & 0xFF;
+	out[8] = frame.generalStatus;
+	out[9] = frame.inputStatus;
+	out[10] = frame.noiseFlags;
+	memcpy(&out[11], frame.delta, 8);
+
+	byte check = 0;
+	for (uint8_t i = 2; i < CAP129N_FRAME_SIZE - 1; i++)
+		check ^= out[i];
+	out[CAP129N_FRAME_SIZE - 1] = check;
+}
+
+/*
+ *	Returns false if the sync bytes or the checksum do not match.
+ */
+bool CAP129nLogger::decode(const byte *in, CAP129nFrame &frame){
+	if (in[0] != CAP129N_FRAME_SYNC_1 || in[1] != CAP129N_FRAME_SYNC_2)
+		return false;
+	byte check = 0;
+	for (uint8_t i = 2; i < CAP129N_FRAME_SIZE - 1; i++)
+		check ^= in[i];
+	if (check != in[CAP129N_FRAME_SIZE - 1])
+		return false;
+
+	frame.sequence = in[2] | (in[3] << 8);
+	frame.timestamp = 0;
+	for (uint8_t i = 0; i < 4; i++)
+		frame.timestamp |= (uint32_t)in[4 + i] << (8 * i);
+	frame.generalStatus = in[8];
+	frame.inputStatus = in[9];
+	frame.noiseFlags = in[10];
+	memcpy(frame.delta, &in[11], 8);
+	return true;
+}
@@ -0,0 +1,76 @@
+/*
+ *	Raw signal logger of the CAP1293/6/8 library. Samples GENERAL_STATUS
+ *	through the delta counts (0x02..0x17) in one burst at a fixed rate and
+ *	packs each sample into a compact binary frame. Frames are buffered in a
+ *	ring and drained to any Print/Stream without blocking.
+ *
+ *	Frame layout, little endian, CAP129N_FRAME_SIZE bytes:
+ *	  0  sync 0xCA		1  sync 0x29
+ *	  2  sequence (16 bit)	4  timestamp in us (32 bit)
+ *	  8  GENERAL_STATUS	9  SENSOR_INPUT_STATUS	10 NOISE_FLAG_STATUS
+ *	  11 delta count CS1..CS8 (signed)
+ *	  19 XOR of bytes 2..18
+ *
+ *	extras/host/cap129n_decode turns a capture into CSV.
+ */
+
+#ifndef __CAP129n_logger_H__
+#define __CAP129n_logger_H__
+
+#include <Arduino.h>
+
+#include "CAP129n_registers.h"
+#include "CAP129n.h"
+
+//Buffered frames
+#ifndef CAP129N_LOGGER_FRAMES
+#define CAP129N_LOGGER_FRAMES 8
+#endif
+
+#define CAP129N_FRAME_SIZE 20
+#define CAP129N_FRAME_SYNC_1 0xCA
+#define CAP129N_FRAME_SYNC_2 0x29
+
+struct CAP129nFrame
+{
+  uint16_t sequence;
+  uint32_t timestamp;
+  uint8_t generalStatus;
+  uint8_t inputStatus;
+  uint8_t noiseFlags;
+  int8_t delta[8];
+};
+
+class CAP129nLogger
+{
+public:
+  CAP129nLogger(CAP129n &device, unsigned long intervalMicros);
+  
+  void setInterval(unsigned long intervalMicros);
+  
+  // Takes a sample when one is due, returns true if a frame was captured (false if it was dropped, see getDroppedFrames())
+  bool sample();
+  
+  // Writes buffered frames to "out", at most "budget" bytes (0 uses availableForWrite(), or no limit if that is 0 too)
+  size_t flush(Print &out, size_t budget = 0);
+  
+  uint8_t framesBuffered();
+  unsigned long getDroppedFrames();
+  
+  static void encode(const CAP129nFrame &frame, byte *out);
+  static bool decode(const byte *in, CAP129nFrame &frame);
+
+private:
+  CAP129n *_device;
+  unsigned long _interval;
+  unsigned long _nextDue;
+  uint16_t _sequence = 0;
+  
+  byte _frames[CAP129N_LOGGER_FRAMES][CAP129N_FRAME_SIZE];
+  uint8_t _head = 0;
+  uint8_t _count = 0;
+  uint8_t _outOffset = 0;	//Bytes of the oldest frame already written
+  unsigned long _dropped = 0;
+};
+
+#endif
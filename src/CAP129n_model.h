@@ -0,0 +1,98 @@
+/*
+ *	Compile-time model specialisation of the CAP1293/6/8 library. The model
+ *	and address are template parameters, channel ids are checked by the
+ *	compiler and per-channel calls reduce to a constant mask.
+ *
+ *	CAP129nModel<MODEL_CAP1296> cap;
+ *	cap.begin();
+ *	cap.enableSensing<4>();
+ *	cap.enableSensing<7>();	// Does not compile, the CAP1296 has 6 inputs
+ *
+ *	It is a layer on top of the runtime CAP129n, not the other way round:
+ *	the only model-dependent code in CAP129n is getChannelCount() and the
+ *	PROD_ID check, so a templated core would mostly duplicate the driver
+ *	per model. What the template saves is the per-channel id handling.
+ */
+
+#ifndef __CAP129n_model_H__
+#define __CAP129n_model_H__
+
+#include <Arduino.h>
+
+#include "CAP129n_registers.h"
+#include "CAP129n.h"
+
+// Number of sensor inputs of a model, usable in constant expressions
+constexpr uint8_t cap129nChannelCount(uint8_t model)
+{
+  return model == MODEL_CAP1293 ? 3 : (model == MODEL_CAP1296 ? 6 : 8);
+}
+
+template <uint8_t MODEL, uint8_t ADDR = DEFAULT_I2C_ADDR>
+class CAP129nModel : public CAP129n
+{
+  static_assert(MODEL == MODEL_CAP1293 || MODEL == MODEL_CAP1296 || MODEL == MODEL_CAP1298, "Unknown CAP129n model");
+
+public:
+  static constexpr uint8_t CHANNELS = cap129nChannelCount(MODEL);
+  static constexpr uint8_t CHANNEL_MASK = (uint8_t)((1 << CHANNELS) - 1);
+  
+  // Register bit of input ID, fails to compile for inputs the model does not have
+  template <uint8_t ID>
+  static constexpr uint8_t channelBit()
+  {
+    static_assert(ID >= 1 && ID <= cap129nChannelCount(MODEL), "Channel id out of range for this model");
+    return (uint8_t)(1 << (ID - 1));
+  }
+  
+  CAP129nModel() : CAP129n(MODEL, ADDR) {}
+  
+  // Same arguments as CAP129n::begin(), the address defaults to ADDR
+  int begin(TwoWire &wirePort = Wire, uint8_t deviceAddress = ADDR, uint8_t sensitivity = SENSITIVITY_32X, bool interrupts = true, bool sgEnable = false)
+  {
+    return CAP129n::begin(wirePort, deviceAddress, sensitivity, interrupts, sgEnable);
+  }
+  
+  int begin(CAP129nTransport &transport, uint8_t deviceAddress = ADDR, uint8_t sensitivity = SENSITIVITY_32X, bool interrupts = true, bool sgEnable = false)
+  {
+    return CAP129n::begin(transport, deviceAddress, sensitivity, interrupts, sgEnable);
+  }
+  
+  uint8_t getChannelCount() { return CHANNELS; }
+  
+  template <uint8_t ID>
+  void enableSensing() { updateRegisterBits(SENSOR_INPUT_ENABLE, channelBit<ID>(), 0xFF); }
+  
+  template <uint8_t ID>
+  void disableSensing() { updateRegisterBits(SENSOR_INPUT_ENABLE, channelBit<ID>(), 0x00); }
+  
+  template <uint8_t ID>
+  bool isEnabledSensing() { return (readCachedRegister(SENSOR_INPUT_ENABLE) & channelBit<ID>()) != 0; }
+  
+  template <uint8_t ID>
+  void calibrateTouch() { writeRegister(CALIBRATION_ACTIVATE_AND_STATUS, channelBit<ID>()); }
+  
+  void calibrateAll() { writeRegister(CALIBRATION_ACTIVATE_AND_STATUS, CHANNEL_MASK); }
+  
+  template <uint8_t ID>
+  bool isTouched()
+  {
+    bool touched = (readRegister(SENSOR_INPUT_STATUS) & channelBit<ID>()) != 0;
+    if (touched)
+      clearInterrupt();
+    return touched;
+  }
+  
+  // Answered from the last poll(), no I2C traffic
+  template <uint8_t ID>
+  bool wasTouched() { return (getSnapshot().inputStatus & channelBit<ID>()) != 0; }
+  
+  // The runtime (uint8_t id) overloads stay callable next to the templates
+  using CAP129n::enableSensing;
+  using CAP129n::disableSensing;
+  using CAP129n::isEnabledSensing;
+  using CAP129n::calibrateTouch;
+  using CAP129n::isTouched;
+};
+
+#endif
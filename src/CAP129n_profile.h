@@ -0,0 +1,137 @@
+/*
+ *	Declarative configuration profile of the CAP1293/6/8 library.
+ *
+ *	A CAP129nConfig holds the register image of the three configuration
+ *	blocks (SENSITIVITY_CONTROL..RECALIBRATION_CONFIG,
+ *	SENSOR_1_INPUT_THRESH..SENSOR_INPUT_NOISE_THRESH and
+ *	STANDBY_CHANNEL..CONFIG_2). It starts from the datasheet power-on
+ *	defaults and every with...() call returns a modified copy, so a
+ *	profile can be built as a constexpr and its image computed at compile
+ *	time:
+ *
+ *	constexpr CAP129nConfig panel = CAP129nConfig()
+ *		.withSensitivity(SENSITIVITY_64X)
+ *		.withSensingMask(0x3F)
+ *		.withRepeatMask(0x00);
+ *	cap.apply(panel);
+ */
+
+#ifndef __CAP129n_profile_H__
+#define __CAP129n_profile_H__
+
+#include <Arduino.h>
+
+#include "CAP129n_registers.h"
+#include "CAP129n.h"
+
+#define CONFIG_IMAGE_SIZE 31
+
+class CAP129nConfig
+{
+public:
+  // Datasheet power-on defaults
+  constexpr CAP129nConfig()
+    : _image{0x2F, 0x20, 0xFF, 0xA4, 0x07, 0x39, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x80, 0x00, 0x00, 0xFF, 0x00, 0x8A,
+             0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x01,
+             0x00, 0x39, 0x02, 0x40, 0x40}
+  {
+  }
+  
+  // Position of "reg" in the image, registers outside the three blocks are not part of a profile
+  static constexpr int8_t imageIndex(uint8_t reg)
+  {
+    return (reg >= SENSITIVITY_CONTROL && reg <= RECALIBRATION_CONFIG) ? reg - SENSITIVITY_CONTROL :
+           (reg >= SENSOR_1_INPUT_THRESH && reg <= SENSOR_INPUT_NOISE_THRESH) ? 17 + reg - SENSOR_1_INPUT_THRESH :
+           (reg >= STANDBY_CHANNEL && reg <= CONFIG_2) ? 26 + reg - STANDBY_CHANNEL : -1;
+  }
+  
+  // Reserved addresses inside the configuration block, never written with a guessed value
+  static constexpr bool isReserved(uint8_t reg)
+  {
+    return reg == 0x25 || reg == 0x2C;
+  }
+  
+  // Reserved, read-only and self-clearing registers inside the blocks are never written from a profile
+  static constexpr bool isWritable(uint8_t reg)
+  {
+    return imageIndex(reg) >= 0 && !isReserved(reg) && reg != CALIBRATION_ACTIVATE_AND_STATUS && reg != BASE_COUNT_OUT;
+  }
+  
+  constexpr uint8_t registerValue(uint8_t reg) const
+  {
+    return imageIndex(reg) >= 0 ? _image[imageIndex(reg)] : 0x00;
+  }
+  
+  // Sets the bits of "reg" selected by "mask" to "bits"
+  constexpr CAP129nConfig withBits(uint8_t reg, uint8_t mask, uint8_t bits) const
+  {
+    return imageIndex(reg) < 0 ? *this : CAP129nConfig(*this, imageIndex(reg), (registerValue(reg) & ~mask) | (bits & mask));
+  }
+  
+  //-----BEGIN PROFILE SETTINGS-----
+  constexpr CAP129nConfig withSensitivity(uint8_t sensitivity) const { return withBits(SENSITIVITY_CONTROL, 0x70, (sensitivity > SENSITIVITY_1X ? SENSITIVITY_32X : sensitivity) << 4); }
+  constexpr CAP129nConfig withBaseShift(uint8_t shift) const { return withBits(SENSITIVITY_CONTROL, 0x0F, shift); }
+  
+  constexpr CAP129nConfig withSMBusTimeout(bool enabled) const { return withBits(CONFIG, 0x80, enabled ? 0x80 : 0x00); }
+  constexpr CAP129nConfig withDigitalNoiseFilter(bool enabled) const { return withBits(CONFIG, 0x20, enabled ? 0x00 : 0x20); }
+  constexpr CAP129nConfig withAnalogNoiseFilter(bool enabled) const { return withBits(CONFIG, 0x10, enabled ? 0x00 : 0x10); }
+  constexpr CAP129nConfig withMaximumHoldDuration(uint8_t duration) const { return withBits(CONFIG, 0x08, 0x08).withBits(SENSOR_INPUT_CONFIG, 0xF0, duration << 4); }
+  constexpr CAP129nConfig withoutMaximumHoldDuration() const { return withBits(CONFIG, 0x08, 0x00); }
+  constexpr CAP129nConfig withRepeatRate(uint8_t rate) const { return withBits(SENSOR_INPUT_CONFIG, 0x0F, rate); }
+  constexpr CAP129nConfig withAveraging(uint8_t averagingConfig) const { return withBits(AVERAGING_AND_SAMPLE_CONFIG, 0xFF, averagingConfig); }
+  
+  constexpr CAP129nConfig withSensingMask(uint8_t mask) const { return withBits(SENSOR_INPUT_ENABLE, 0xFF, mask); }
+  constexpr CAP129nConfig withInterruptMask(uint8_t mask) const { return withBits(INTERRUPT_ENABLE, 0xFF, mask); }
+  constexpr CAP129nConfig withRepeatMask(uint8_t mask) const { return withBits(REPEAT_RATE_ENABLE, 0xFF, mask); }
+  // The guard is driven on CS2, so any guarded input also turns CS2 sensing off
+  constexpr CAP129nConfig withSignalGuardMask(uint8_t mask) const { return withBits(SIGNAL_GUARD_ENABLE, 0xFF, mask).withBits(SENSOR_INPUT_ENABLE, 0x02, mask ? 0x00 : registerValue(SENSOR_INPUT_ENABLE)); }
+  
+  // 0 disables the limit, 1..4 simultaneous touches otherwise
+  constexpr CAP129nConfig withMultipleTouchLimit(uint8_t touches) const { return touches == 0 ? withBits(MULTIPLE_TOUCH_CONFIG, 0x80, 0x00) : withBits(MULTIPLE_TOUCH_CONFIG, 0x8C, 0x80 | (((touches > 4 ? 4 : touches) - 1) << 2)); }
+  constexpr CAP129nConfig withMTPDetection(bool enabled) const { return withBits(MULTIPLE_TOUCH_PATTERN_CONFIG, 0x80, enabled ? 0x80 : 0x00); }
+  constexpr CAP129nConfig withMTPDetectionMode(uint8_t mode) const { return withBits(MULTIPLE_TOUCH_PATTERN_CONFIG, 0x02, mode == MTP_MODE_SPECIFIC ? 0x02 : 0x00); }
+  constexpr CAP129nConfig withMTPDetectionTreshold(uint8_t tresh) const { return withBits(MULTIPLE_TOUCH_PATTERN_CONFIG, 0x0C, (tresh - 1) << 2); }
+  constexpr CAP129nConfig withMTPInterrupt(bool enabled) const { return withBits(MULTIPLE_TOUCH_PATTERN_CONFIG, 0x01, enabled ? 0x01 : 0x00); }
+  constexpr CAP129nConfig withMTPPattern(uint8_t mask) const { return withBits(MULTIPLE_TOUCH_PATTERN, 0xFF, mask); }
+  constexpr CAP129nConfig withRecalibration(uint8_t recalibrationConfig) const { return withBits(RECALIBRATION_CONFIG, 0xFF, recalibrationConfig); }
+  
+  // Thresholds are 7 bit, id 1..8
+  constexpr CAP129nConfig withThreshold(uint8_t id, uint8_t threshold) const { return (id < 1 || id > 8) ? *this : withBits(SENSOR_1_INPUT_THRESH + id - 1, 0x7F, threshold); }
+  constexpr CAP129nConfig withThresholds(uint8_t threshold) const { return withThresholdsFrom(1, threshold); }
+  constexpr CAP129nConfig withNoiseThreshold(uint8_t threshold) const { return withBits(SENSOR_INPUT_NOISE_THRESH, 0x03, threshold); }
+  
+  constexpr CAP129nConfig withStandbyChannels(uint8_t mask) const { return withBits(STANDBY_CHANNEL, 0xFF, mask); }
+  constexpr CAP129nConfig withStandbyConfig(uint8_t standbyConfig) const { return withBits(STANDBY_CONFIG, 0xFF, standbyConfig); }
+  constexpr CAP129nConfig withStandbySensitivity(uint8_t sensitivity) const { return withBits(STANDBY_SENSITIVITY, 0x07, sensitivity > SENSITIVITY_1X ? SENSITIVITY_32X : sensitivity); }
+  constexpr CAP129nConfig withStandbyThreshold(uint8_t threshold) const { return withBits(STANDBY_THRESH, 0x7F, threshold); }
+  
+  constexpr CAP129nConfig withRFNoiseFilter(bool enabled) const { return withBits(CONFIG_2, 0x04, enabled ? 0x00 : 0x04); }
+  constexpr CAP129nConfig withRFNoiseOnly(bool enabled) const { return withBits(CONFIG_2, 0x08, enabled ? 0x08 : 0x00); }
+  constexpr CAP129nConfig withInterruptOnRelease(bool enabled) const { return withBits(CONFIG_2, 0x01, enabled ? 0x00 : 0x01); }
+  //-----END PROFILE SETTINGS-----
+
+private:
+  constexpr CAP129nConfig(const CAP129nConfig &o, int8_t i, uint8_t v)
+    : _image{pick(o, 0, i, v), pick(o, 1, i, v), pick(o, 2, i, v), pick(o, 3, i, v), pick(o, 4, i, v), pick(o, 5, i, v),
+             pick(o, 6, i, v), pick(o, 7, i, v), pick(o, 8, i, v), pick(o, 9, i, v), pick(o, 10, i, v), pick(o, 11, i, v),
+             pick(o, 12, i, v), pick(o, 13, i, v), pick(o, 14, i, v), pick(o, 15, i, v), pick(o, 16, i, v), pick(o, 17, i, v),
+             pick(o, 18, i, v), pick(o, 19, i, v), pick(o, 20, i, v), pick(o, 21, i, v), pick(o, 22, i, v), pick(o, 23, i, v),
+             pick(o, 24, i, v), pick(o, 25, i, v), pick(o, 26, i, v), pick(o, 27, i, v), pick(o, 28, i, v), pick(o, 29, i, v),
+             pick(o, 30, i, v)}
+  {
+  }
+  
+  static constexpr uint8_t pick(const CAP129nConfig &o, int8_t k, int8_t i, uint8_t v)
+  {
+    return k == i ? v : o._image[k];
+  }
+  
+  constexpr CAP129nConfig withThresholdsFrom(uint8_t id, uint8_t threshold) const
+  {
+    return id > 8 ? *this : withThreshold(id, threshold).withThresholdsFrom(id + 1, threshold);
+  }
+  
+  uint8_t _image[CONFIG_IMAGE_SIZE];
+};
+
+#endif
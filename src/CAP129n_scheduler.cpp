@@ -0,0 +1,114 @@
+/*
+ *	This file contains the implementation of the CAP129n adaptive polling
+ *	scheduler.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_scheduler.h"
+
+CAP129nScheduler::CAP129nScheduler(CAP129n &device){
+	_device = &device;
+}
+
+void CAP129nScheduler::setPolicy(unsigned long minIntervalUs, unsigned long maxIntervalUs, unsigned long holdUs, uint8_t backoffPercent){
+	_minInterval = minIntervalUs;
+	_maxInterval = maxIntervalUs < minIntervalUs ? minIntervalUs : maxIntervalUs;
+	_hold = holdUs;
+	_backoffPercent = backoffPercent;
+	_interval = _minInterval;
+}
+
+void CAP129nScheduler::setAlertWake(bool enabled){
+	_alertWake = enabled;
+	if (!enabled && _alertIdle)
+	{
+		_alertIdle = false;
+		_device->setAlertMode(false);
+	}
+}
+
+/*
+ *	In ALERT idle the device only touches the bus after its ALERT pin
+ *	fired, any event brings the scheduler back to the fastest rate.
+ */
+uint8_t CAP129nScheduler::service(){
+	unsigned long now = micros();
+
+	if (_alertIdle)
+	{
+		uint8_t queued = _device->service();
+		if (queued)
+		{
+			_alertIdle = false;
+			_device->setAlertMode(false);
+			_interval = _minInterval;
+			_lastActivity = now;
+			_polled = false;	//The idle gap is not a polling latency
+			_nextPoll = now + _interval;
+		}
+		return queued;
+	}
+
+	if (_polled && (long)(now - _nextPoll) < 0)
+		return 0;
+
+	if (_polled && now - _lastPoll > _worstLatency)
+		_worstLatency = now - _lastPoll;
+	_lastPoll = now;
+	_polled = true;
+	_windowPolls++;
+	if (now - _windowStart >= 1000000UL)
+	{
+		// In ms, so the product stays within 32 bits for any realistic rate, the window is at least 1000 ms
+		_pollRate = (_windowPolls * 1000UL) / ((now - _windowStart) / 1000UL);
+		_windowStart = now;
+		_windowPolls = 0;
+	}
+
+	uint8_t queued = _device->service();
+	if (queued || _device->getSnapshot().inputStatus)
+	{
+		_lastActivity = now;
+		_interval = _minInterval;
+	}
+	else if (now - _lastActivity >= _hold)
+	{
+		_interval += (_interval * _backoffPercent) / 100 + 1;
+		if (_interval >= _maxInterval)
+		{
+			_interval = _maxInterval;
+			if (_alertWake)
+			{
+				_alertIdle = true;
+				_device->setAlertMode(true);
+			}
+		}
+	}
+	_nextPoll = now + _interval;
+	return queued;
+}
+
+unsigned long CAP129nScheduler::getInterval(){
+	return _interval;
+}
+
+unsigned long CAP129nScheduler::getPollRate(){
+	return _pollRate;
+}
+
+unsigned long CAP129nScheduler::getWorstLatency(){
+	return _worstLatency;
+}
+
+bool CAP129nScheduler::isAlertIdle(){
+	return _alertIdle;
+}
+
+void CAP129nScheduler::resetStats(){
+	_worstLatency = 0;
+	_windowPolls = 0;
+	_windowStart = micros();
+	_pollRate = 0;
+}
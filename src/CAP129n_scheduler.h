@@ -0,0 +1,61 @@
+/*
+ *	Adaptive polling scheduler of the CAP1293/6/8 library. Polls fast while
+ *	inputs are touched or were released recently and backs off
+ *	exponentially while the panel is idle. Once the slowest rate is reached
+ *	it can hand over to ALERT-pin wake and stop polling altogether.
+ */
+
+#ifndef __CAP129n_scheduler_H__
+#define __CAP129n_scheduler_H__
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+
+//Default policy
+#define SCHEDULER_MIN_INTERVAL_US 10000UL	//While active
+#define SCHEDULER_MAX_INTERVAL_US 200000UL	//Slowest idle rate
+#define SCHEDULER_HOLD_US 500000UL		//Stay fast this long after the last activity
+#define SCHEDULER_BACKOFF_PERCENT 50		//Interval growth per idle poll
+
+class CAP129nScheduler
+{
+public:
+  CAP129nScheduler(CAP129n &device);
+  
+  void setPolicy(unsigned long minIntervalUs, unsigned long maxIntervalUs, unsigned long holdUs, uint8_t backoffPercent);
+  
+  // Hand over to ALERT-pin wake when fully idle, the sketch must call device.handleAlert() from the ISR
+  void setAlertWake(bool enabled);
+  
+  // Call every loop, polls only when due, returns the number of events queued on the device
+  uint8_t service();
+  
+  unsigned long getInterval();		//Current poll interval, us
+  unsigned long getPollRate();		//Polls per second over the last full second
+  unsigned long getWorstLatency();	//Longest gap between timed polls since resetStats(), us
+  bool isAlertIdle();
+  void resetStats();
+
+private:
+  CAP129n *_device;
+  unsigned long _minInterval = SCHEDULER_MIN_INTERVAL_US;
+  unsigned long _maxInterval = SCHEDULER_MAX_INTERVAL_US;
+  unsigned long _hold = SCHEDULER_HOLD_US;
+  uint8_t _backoffPercent = SCHEDULER_BACKOFF_PERCENT;
+  bool _alertWake = false;
+  bool _alertIdle = false;
+  
+  unsigned long _interval = SCHEDULER_MIN_INTERVAL_US;
+  unsigned long _nextPoll = 0;
+  unsigned long _lastPoll = 0;
+  unsigned long _lastActivity = 0;
+  bool _polled = false;
+  
+  unsigned long _windowStart = 0;
+  unsigned long _windowPolls = 0;
+  unsigned long _pollRate = 0;
+  unsigned long _worstLatency = 0;
+};
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ *	Build options of the CAP1293/6/8 library. The Arduino IDE does not
+ *	pass a sketch's #defines on to library sources, so set these here or
+ *	as compiler flags (-DCAP129N_INSTRUMENTATION=1).
+ */
+
+#ifndef __CAP129n_settings_H__
+#define __CAP129n_settings_H__
+
+//Latency histograms for transfers, begin(), poll(), service(), apply() and ALERT to event, costs about 280 bytes of RAM per device
+#ifndef CAP129N_INSTRUMENTATION
+#define CAP129N_INSTRUMENTATION 0
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ *	This file contains the implementation of the CAP129n slider and wheel
+ *	engine.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_slider.h"
+
+CAP129nSlider::CAP129nSlider(){
+}
+
+bool CAP129nSlider::setChannels(const uint8_t *ids, uint8_t count, bool wheel){
+	if (count < 2 || count > 8)
+		return false;
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (ids[i] < 1 || ids[i] > 8)
+			return false;
+		_ids[i] = ids[i];
+	}
+	_count = count;
+	_wheel = wheel;
+	_touched = false;
+	_velocity = 0;
+	return true;
+}
+
+void CAP129nSlider::setTouchDelta(int8_t minDelta){
+	_minDelta = minDelta;
+}
+
+bool CAP129nSlider::update(CAP129n &device){
+	int8_t delta[8] = {0};
+	if (device.readDeltaCounts(delta) == 0)
+		return false;
+	return update(delta, micros());
+}
+
+bool CAP129nSlider::update(const int8_t delta[8]){
+	return update(delta, micros());
+}
+
+/*
+ *	The position is the centroid of the strongest electrode and its two
+ *	neighbours, (right - left) / (left + peak + right) of a step away from
+ *	the peak. Negative deltas count as 0. On a wheel the neighbours wrap
+ *	around, on a slider the missing neighbour at either end is 0 and the
+ *	result is clamped to the range.
+ */
+bool CAP129nSlider::update(const int8_t delta[8], unsigned long now){
+	if (_count == 0)
+		return false;
+
+	uint8_t peak = 0;
+	int16_t peakValue = 0;
+	for (uint8_t i = 0; i < _count; i++)
+	{
+		int16_t value = delta[_ids[i] - 1];
+		if (value > peakValue)
+		{
+			peakValue = value;
+			peak = i;
+		}
+	}
+
+	if (peakValue < _minDelta)
+	{
+		_touched = false;
+		_velocity = 0;
+		return false;
+	}
+
+	int16_t left = 0;
+	int16_t right = 0;
+	if (peak > 0 || _wheel)
+		left = delta[_ids[(peak + _count - 1) % _count] - 1];
+	if (peak < _count - 1 || _wheel)
+		right = delta[_ids[(peak + 1) % _count] - 1];
+	if (left < 0)
+		left = 0;
+	if (right < 0)
+		right = 0;
+
+	int32_t range = getRange();
+	int32_t position = (int32_t)peak * CAP129N_SLIDER_RESOLUTION + ((int32_t)(right - left) * CAP129N_SLIDER_RESOLUTION) / (left + peakValue + right);
+	if (_wheel)
+	{
+		position = (position + range) % range;
+	}
+	else if (position < 0)
+	{
+		position = 0;
+	}
+	else if (position > range - 1)
+	{
+		position = range - 1;
+	}
+
+	if (_touched && now != _lastMicros)
+	{
+		int32_t moved = position - _position;
+		// A wheel moves the short way round
+		if (_wheel && moved > range / 2)
+			moved -= range;
+		else if (_wheel && moved < -range / 2)
+			moved += range;
+		// |moved| <= 7 * CAP129N_SLIDER_RESOLUTION, so this stays within 32 bits
+		_velocity = (moved * 1000000L) / (long)(now - _lastMicros);
+	}
+	else
+	{
+		_velocity = 0;
+	}
+
+	_position = position;
+	_lastMicros = now;
+	_touched = true;
+	return true;
+}
+
+bool CAP129nSlider::isTouched(){
+	return _touched;
+}
+
+uint16_t CAP129nSlider::getPosition(){
+	return _position;
+}
+
+/*
+ *	A slider spans count - 1 steps between its end electrodes, a wheel
+ *	spans count steps around.
+ */
+uint16_t CAP129nSlider::getRange(){
+	if (_count == 0)
+		return 0;
+	return (_wheel ? _count : _count - 1) * CAP129N_SLIDER_RESOLUTION + (_wheel ? 0 : 1);
+}
+
+int32_t CAP129nSlider::getVelocity(){
+	return _velocity;
+}
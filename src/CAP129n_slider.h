@@ -0,0 +1,52 @@
+/*
+ *	Slider and wheel position engine of the CAP1293/6/8 library. A group
+ *	of inputs laid out in a row (slider) or a circle (wheel) is mapped to
+ *	a position with CAP129N_SLIDER_RESOLUTION steps between neighbouring
+ *	electrodes, interpolated in fixed point from one burst of delta counts.
+ */
+
+#ifndef __CAP129n_slider_H__
+#define __CAP129n_slider_H__
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+
+//Position steps between two neighbouring electrodes
+#define CAP129N_SLIDER_RESOLUTION 256
+
+//Default minimum peak delta count for a touch
+#define CAP129N_SLIDER_TOUCH_DELTA 10
+
+class CAP129nSlider
+{
+public:
+  CAP129nSlider();
+  
+  // "ids" are the inputs (1..8) in physical order, 2 to 8 of them
+  bool setChannels(const uint8_t *ids, uint8_t count, bool wheel = false);
+  void setTouchDelta(int8_t minDelta);
+  
+  // One readDeltaCounts() burst, then update(delta)
+  bool update(CAP129n &device);
+  bool update(const int8_t delta[8]);
+  bool update(const int8_t delta[8], unsigned long nowMicros);
+  
+  bool isTouched();
+  uint16_t getPosition();	//0..getRange()-1, last valid position while untouched
+  uint16_t getRange();
+  int32_t getVelocity();	//Position steps per second, 0 while untouched
+
+private:
+  uint8_t _ids[8];
+  uint8_t _count = 0;
+  bool _wheel = false;
+  int8_t _minDelta = CAP129N_SLIDER_TOUCH_DELTA;
+  
+  bool _touched = false;
+  uint16_t _position = 0;
+  int32_t _velocity = 0;
+  unsigned long _lastMicros = 0;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ *	This file contains the implementation of the CAP129n latency
+ *	histograms.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n_stats.h"
+
+/*
+ *	A full bucket halves every bucket, the shape of the distribution is
+ *	kept and the percentiles stay meaningful on long runs.
+ */
+void CAP129nHistogram::record(unsigned long us)
+{
+    uint8_t bucket = 0;
+    while (us >> bucket && bucket < CAP129N_HISTOGRAM_BUCKETS - 1)
+        bucket++;
+
+    if (buckets[bucket] == 0xFFFF)
+    {
+        for (uint8_t i = 0; i < CAP129N_HISTOGRAM_BUCKETS; i++)
+            buckets[i] >>= 1;
+    }
+    buckets[bucket]++;
+    count++;
+    if (us > max)
+        max = us;
+}
+
+unsigned long CAP129nHistogram::percentile(uint8_t percent) const
+{
+    unsigned long total = 0;
+    for (uint8_t i = 0; i < CAP129N_HISTOGRAM_BUCKETS; i++)
+        total += buckets[i];
+    if (total == 0)
+        return 0;
+
+    unsigned long target = (total * percent + 99) / 100;
+    unsigned long seen = 0;
+    for (uint8_t i = 0; i < CAP129N_HISTOGRAM_BUCKETS - 1; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+        {
+            unsigned long upper = (1UL << i) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+CAP129nStats::CAP129nStats(){
+	reset();
+}
+
+void CAP129nStats::record(uint8_t kind, unsigned long us){
+	if (kind < STAT_OP_KINDS)
+		_histograms[kind].record(us);
+}
+
+void CAP129nStats::reset(){
+	memset(_histograms, 0, sizeof(_histograms));
+}
+
+const CAP129nHistogram &CAP129nStats::get(uint8_t kind) const{
+	return _histograms[kind < STAT_OP_KINDS ? kind : 0];
+}
+
+const char *CAP129nStats::kindName(uint8_t kind){
+	switch (kind)
+	{
+	case STAT_OP_READ:
+		return "read";
+	case STAT_OP_WRITE:
+		return "write";
+	case STAT_OP_POLL:
+		return "poll";
+	case STAT_OP_SERVICE:
+		return "service";
+	case STAT_OP_APPLY:
+		return "apply";
+	case STAT_OP_ALERT_TO_EVENT:
+		return "alert_to_event";
+	case STAT_OP_BEGIN:
+		return "begin";
+	default:
+		return "?";
+	}
+}
+
+/*
+ *	Plain text, one operation kind per line:
+ *	"<kind> <count> <max> <p50> <p99>", times in microseconds.
+ */
+void CAP129nStats::dump(Print &out) const{
+	for (uint8_t kind = 0; kind < STAT_OP_KINDS; kind++)
+	{
+		const CAP129nHistogram &h = _histograms[kind];
+		out.print(kindName(kind));
+		out.print(" ");
+		out.print(h.count);
+		out.print(" ");
+		out.print(h.max);
+		out.print(" ");
+		out.print(h.percentile(50));
+		out.print(" ");
+		out.println(h.percentile(99));
+	}
+}
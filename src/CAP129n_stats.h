@@ -0,0 +1,80 @@
+/*
+ *	Latency instrumentation of the CAP1293/6/8 library. Every timed
+ *	operation goes into a log2 histogram of microseconds, fixed size, no
+ *	allocation. Only compiled into CAP129n when CAP129N_INSTRUMENTATION is
+ *	set in CAP129n_settings.h.
+ *	Every bus transaction is timed as a read or write. Of the public calls
+ *	only begin(), apply(), poll() and service() get their own histogram,
+ *	the one-register getters and setters are the read and write they make.
+ */
+
+#ifndef __CAP129n_stats_H__
+#define __CAP129n_stats_H__
+
+#include <Arduino.h>
+
+#include "CAP129n_settings.h"
+
+//Bucket b counts times in [2^(b-1), 2^b) us, the last one everything above
+#define CAP129N_HISTOGRAM_BUCKETS 16
+
+//Operation kinds
+#define STAT_OP_READ 0			//readRegisters(), including retries
+#define STAT_OP_WRITE 1			//writeRegisters(), including retries
+#define STAT_OP_POLL 2
+#define STAT_OP_SERVICE 3
+#define STAT_OP_APPLY 4
+#define STAT_OP_ALERT_TO_EVENT 5	//handleAlert() to the event being queued
+#define STAT_OP_BEGIN 6			//begin() or beginFast()
+#define STAT_OP_KINDS 7
+
+struct CAP129nHistogram
+{
+  unsigned long count;
+  unsigned long max;
+  uint16_t buckets[CAP129N_HISTOGRAM_BUCKETS];
+
+  void record(unsigned long us);
+  // Upper bound of the bucket holding the "percent" percentile, in us
+  unsigned long percentile(uint8_t percent) const;
+};
+
+class CAP129nStats
+{
+public:
+  CAP129nStats();
+
+  void record(uint8_t kind, unsigned long us);
+  void reset();
+  const CAP129nHistogram &get(uint8_t kind) const;
+
+  // One line per operation kind: name, count, max, p50 and p99 in us
+  void dump(Print &out) const;
+  static const char *kindName(uint8_t kind);
+
+private:
+  CAP129nHistogram _histograms[STAT_OP_KINDS];
+};
+
+#if CAP129N_INSTRUMENTATION
+// Records the time from construction to the end of the enclosing scope
+class CAP129nStatTimer
+{
+public:
+  CAP129nStatTimer(CAP129nStats &stats, uint8_t kind) : _stats(stats), _kind(kind), _start(micros()) {}
+  ~CAP129nStatTimer() { _stats.record(_kind, micros() - _start); }
+
+private:
+  CAP129nStats &_stats;
+  uint8_t _kind;
+  unsigned long _start;
+};
+
+#define CAP129N_TIME(stats, kind) CAP129nStatTimer statTimer(stats, kind)
+#define CAP129N_RECORD(stats, kind, us) (stats).record(kind, us)
+#else
+#define CAP129N_TIME(stats, kind) do {} while (0)
+#define CAP129N_RECORD(stats, kind, us) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ *	This file contains the Wire implementation of the CAP129n transport.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "CAP129n_transport.h"
+
+int CAP129nTransport::readBatch(uint8_t address, const CAP129nRead *reads, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int result = writeRead(address, reads[i].reg, reads[i].buffer, reads[i].len);
+        if (result != I2C_SUCCESS)
+            return result;
+    }
+    return I2C_SUCCESS;
+}
+
+CAP129nWireTransport::CAP129nWireTransport(TwoWire &wirePort){
+	_i2cPort = &wirePort;
+}
+
+int CAP129nWireTransport::writeRead(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len)
+{
+    _i2cPort->beginTransmission(address);
+    _i2cPort->write(reg);
+    int result = status(_i2cPort->endTransmission(false));	// endTransmission but keep the connection active
+    if (result != I2C_SUCCESS)
+        return result;
+    return burstRead(address, buffer, len);
+}
+
+int CAP129nWireTransport::write(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len)
+{
+    _i2cPort->beginTransmission(address);
+    _i2cPort->write(reg);
+    for (int i = 0; i < len; i++)
+        _i2cPort->write(buffer[i]);
+    return status(_i2cPort->endTransmission()); // Stop transmitting
+}
+
+/*
+ *	The buffer is only filled if every byte arrived, leftovers of a short
+ *	read are drained so they can not end up in the next transfer.
+ */
+int CAP129nWireTransport::burstRead(uint8_t address, uint8_t *buffer, uint8_t len)
+{
+    // Ask for bytes, once done, bus is released by default
+    if (_i2cPort->requestFrom(address, len) != len || _i2cPort->available() != len)
+    {
+        while (_i2cPort->available())
+            _i2cPort->read();
+        return ERR_I2C_SHORT_READ;
+    }
+    for (int i = 0; i < len; i++)
+        buffer[i] = _i2cPort->read();
+    return I2C_SUCCESS;
+}
+
+int CAP129nWireTransport::probe(uint8_t address)
+{
+    _i2cPort->beginTransmission(address);
+    return status(_i2cPort->endTransmission());
+}
+
+// endTransmission() returns 2 for an address NACK and 3 for a data NACK
+int CAP129nWireTransport::status(uint8_t endTransmissionResult)
+{
+    if (endTransmissionResult == 0)
+        return I2C_SUCCESS;
+    return (endTransmissionResult == 2 || endTransmissionResult == 3) ? ERR_I2C_NACK : ERR_I2C_BUS;
+}
@@ -0,0 +1,63 @@
+/*
+ *	I2C transport of the CAP1293/6/8 library. CAP129n only talks to the
+ *	chip through these three primitives, so any bus implementation (Wire,
+ *	a bit-banged bus, a vendor HAL, a host mock) plugs in by implementing
+ *	them. Retries, counters and the register shadow stay in the driver.
+ */
+
+#ifndef __CAP129n_transport_H__
+#define __CAP129n_transport_H__
+
+#include <Arduino.h>
+#include <Wire.h>
+
+//Transfer statuses, see CAP129n::getLastError()
+#define I2C_SUCCESS 0
+#define ERR_I2C_NACK 3
+#define ERR_I2C_SHORT_READ 4
+#define ERR_I2C_BUS 5		//Timeout or other bus error
+#define ERR_I2C_SKIPPED 6	//Write dropped, the read it was based on failed
+
+// One register read of a batch
+struct CAP129nRead
+{
+  uint8_t reg;
+  uint8_t *buffer;
+  uint8_t len;
+};
+
+class CAP129nTransport
+{
+public:
+  virtual ~CAP129nTransport() {}
+  
+  // Register pointer write, repeated start, then "len" bytes read into "buffer"
+  virtual int writeRead(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len) = 0;
+  // "reg" followed by "len" bytes in one transaction, len may be 0
+  virtual int write(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len) = 0;
+  // "len" bytes from the current register pointer, no pointer write
+  virtual int burstRead(uint8_t address, uint8_t *buffer, uint8_t len) = 0;
+  // Address only transaction, I2C_SUCCESS if the device ACKs
+  virtual int probe(uint8_t address) = 0;
+  // Several register reads, one writeRead() each unless the bus can combine them
+  virtual int readBatch(uint8_t address, const CAP129nRead *reads, uint8_t count);
+};
+
+// Arduino Wire, or anything with the TwoWire API
+class CAP129nWireTransport : public CAP129nTransport
+{
+public:
+  CAP129nWireTransport(TwoWire &wirePort = Wire);
+  
+  int writeRead(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len);
+  int write(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len);
+  int burstRead(uint8_t address, uint8_t *buffer, uint8_t len);
+  int probe(uint8_t address);
+  
+private:
+  static int status(uint8_t endTransmissionResult);
+  
+  TwoWire *_i2cPort;
+};
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ *	This file contains the implementation of the CAP129n auto-tuner.
+ */
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_profile.h"
+#include "CAP129n_tune.h"
+
+//Samples kept per input and phase, keeps the sums in 32 bits
+#define TUNE_MAX_SAMPLES 65535UL
+
+CAP129nTuner::CAP129nTuner(uint8_t sensitivity){
+	setMargins(TUNE_NOISE_MARGIN_PERCENT, TUNE_DETECT_PERCENT);
+	reset(sensitivity);
+}
+
+void CAP129nTuner::reset(uint8_t sensitivity){
+	_measured = (sensitivity > SENSITIVITY_1X) ? SENSITIVITY_32X : sensitivity;
+	_phase = TUNE_PHASE_NONE;
+	_touchId = 0;
+	memset(_idleCount, 0, sizeof(_idleCount));
+	memset(_idleSquares, 0, sizeof(_idleSquares));
+	memset(_idlePeak, 0, sizeof(_idlePeak));
+	memset(_touchCount, 0, sizeof(_touchCount));
+	memset(_touchSum, 0, sizeof(_touchSum));
+	memset(_thresholds, 0, sizeof(_thresholds));
+	_sensitivity = _measured;
+}
+
+void CAP129nTuner::setMargins(uint16_t noiseMarginPercent, uint8_t detectPercent){
+	_noiseMargin = noiseMarginPercent;
+	_detect = detectPercent;
+}
+
+// No input may be touched during this phase
+void CAP129nTuner::beginIdle(){
+	_phase = TUNE_PHASE_IDLE;
+}
+
+// Only input "id" is touched, run the idle phase first so finger-off samples can be told apart
+void CAP129nTuner::beginTouch(uint8_t id){
+	if (id < 1 || id > 8)
+		return;
+	_phase = TUNE_PHASE_TOUCH;
+	_touchId = id;
+}
+
+void CAP129nTuner::endPhase(){
+	_phase = TUNE_PHASE_NONE;
+}
+
+uint8_t CAP129nTuner::getPhase(){
+	return _phase;
+}
+
+bool CAP129nTuner::update(CAP129n &device){
+	int8_t delta[8] = {0};
+	device.poll(delta);
+	if (device.getLastError() != I2C_SUCCESS)
+		return false;
+	sample(delta);
+	return true;
+}
+
+void CAP129nTuner::sample(const int8_t delta[8]){
+	if (_phase == TUNE_PHASE_IDLE)
+		addIdle(delta);
+	else if (_phase == TUNE_PHASE_TOUCH)
+		addTouch(_touchId, delta[_touchId - 1]);
+}
+
+void CAP129nTuner::addIdle(const int8_t delta[8]){
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		if (_idleCount[i] >= TUNE_MAX_SAMPLES)
+			continue;
+		uint8_t magnitude = delta[i] < 0 ? -delta[i] : delta[i];
+		_idleCount[i]++;
+		_idleSquares[i] += (uint16_t)magnitude * magnitude;
+		if (magnitude > _idlePeak[i])
+			_idlePeak[i] = magnitude;
+	}
+}
+
+/*
+ *	Samples at or below the idle noise peak are taken as the finger not
+ *	being on the input yet (or any more) and are skipped.
+ */
+void CAP129nTuner::addTouch(uint8_t id, int8_t delta){
+	if (id < 1 || id > 8)
+		return;
+	uint8_t i = id - 1;
+	if (_touchCount[i] >= TUNE_MAX_SAMPLES || delta <= 0 || delta <= _idlePeak[i])
+		return;
+	_touchCount[i]++;
+	_touchSum[i] += delta;
+}
+
+/*
+ *	Each DELTA_SENSE step doubles or halves the delta counts, so the
+ *	captured noise and signal are scaled to every setting from the most
+ *	sensitive down. The delta count register saturates at 127, which is
+ *	what stops the most sensitive settings. The threshold is placed at
+ *	the noise margin, the lowest value that keeps it.
+ */
+bool CAP129nTuner::solve(){
+	for (uint8_t s = SENSITIVITY_128X; s <= SENSITIVITY_1X; s++)
+	{
+		int8_t shift = (int8_t)_measured - (int8_t)s;
+		bool fits = true;
+		for (uint8_t i = 0; i < 8; i++)
+		{
+			_thresholds[i] = 0;
+			if (_touchCount[i] == 0)
+				continue;
+			uint32_t noise = scale(_idlePeak[i] ? _idlePeak[i] : 1, shift, true);
+			uint32_t signal = scale(_touchSum[i] / _touchCount[i], shift, false);
+			if (signal > 127)
+				signal = 127;
+			uint32_t threshold = (noise * _noiseMargin + 99) / 100;
+			if (threshold < 1)
+				threshold = 1;
+			if (threshold > 127 || threshold * 100 > signal * _detect)
+				fits = false;
+			_thresholds[i] = threshold > 127 ? 127 : threshold;
+		}
+		_sensitivity = s;
+		if (fits)
+			return true;
+	}
+	return false;
+}
+
+uint8_t CAP129nTuner::getSensitivity(){
+	return _sensitivity;
+}
+
+uint8_t CAP129nTuner::getThreshold(uint8_t id){
+	if (id < 1 || id > 8)
+		return 0;
+	return _thresholds[id - 1];
+}
+
+uint8_t CAP129nTuner::getTunedMask(){
+	uint8_t mask = 0x00;
+	for (uint8_t i = 0; i < 8; i++)
+		if (_touchCount[i])
+			mask |= 1 << i;
+	return mask;
+}
+
+// "base" with the solved sensitivity and the thresholds of the tuned inputs
+CAP129nConfig CAP129nTuner::getConfig(const CAP129nConfig &base){
+	CAP129nConfig config = base.withSensitivity(_sensitivity);
+	for (uint8_t id = 1; id <= 8; id++)
+		if (_thresholds[id - 1])
+			config = config.withThreshold(id, _thresholds[id - 1]);
+	return config;
+}
+
+uint8_t CAP129nTuner::getNoisePeak(uint8_t id){
+	if (id < 1 || id > 8)
+		return 0;
+	return _idlePeak[id - 1];
+}
+
+uint8_t CAP129nTuner::getSignal(uint8_t id){
+	if (id < 1 || id > 8 || _touchCount[id - 1] == 0)
+		return 0;
+	return _touchSum[id - 1] / _touchCount[id - 1];
+}
+
+uint16_t CAP129nTuner::getSNR(uint8_t id){
+	if (id < 1 || id > 8 || _idleCount[id - 1] == 0)
+		return 0;
+	uint8_t i = id - 1;
+	uint32_t count = _idleCount[i];
+	uint32_t meanSquare100 = (_idleSquares[i] / count) * 100 + ((_idleSquares[i] % count) * 100) / count;
+	uint32_t rms10 = isqrt(meanSquare100);
+	if (rms10 == 0)
+		rms10 = 1;
+	uint32_t snr10 = (uint32_t)getSignal(id) * 100 / rms10;
+	return snr10 > 0xFFFF ? 0xFFFF : snr10;
+}
+
+unsigned long CAP129nTuner::getIdleSamples(uint8_t id){
+	if (id < 1 || id > 8)
+		return 0;
+	return _idleCount[id - 1];
+}
+
+unsigned long CAP129nTuner::getTouchSamples(uint8_t id){
+	if (id < 1 || id > 8)
+		return 0;
+	return _touchCount[id - 1];
+}
+
+uint16_t CAP129nTuner::isqrt(uint32_t value){
+	uint32_t root = 0;
+	uint32_t bit = 1UL << 30;
+	while (bit > value)
+		bit >>= 2;
+	while (bit)
+	{
+		if (value >= root + bit)
+		{
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+// Positive "shift" is more gain, noise is rounded up and signal down when reducing
+uint16_t CAP129nTuner::scale(uint16_t value, int8_t shift, bool roundUp){
+	if (shift >= 0)
+		return value << shift;
+	if (roundUp)
+		value += (1 << -shift) - 1;
+	return value >> -shift;
+}
@@ -0,0 +1,82 @@
+/*
+ *	Auto-tuning of the CAP1293/6/8 library. Delta counts are collected
+ *	with no touch and with guided touches of each input, at the
+ *	sensitivity currently on the chip. solve() then picks the most
+ *	sensitive DELTA_SENSE setting at which every touched input keeps its
+ *	threshold above the noise by the false-trigger margin and below its
+ *	touch signal, and sets the thresholds accordingly. The same engine
+ *	runs offline on CAP129nLogger traces (see extras/host/cap129n_tune).
+ */
+
+#ifndef __CAP129n_tune_H__
+#define __CAP129n_tune_H__
+
+#include <Arduino.h>
+
+#include "CAP129n.h"
+#include "CAP129n_profile.h"
+
+//Default margins
+#define TUNE_NOISE_MARGIN_PERCENT 200	//Threshold at least this much of the idle noise peak
+#define TUNE_DETECT_PERCENT 60		//Threshold at most this much of the mean touch signal
+
+//Capture phases
+#define TUNE_PHASE_NONE 0
+#define TUNE_PHASE_IDLE 1
+#define TUNE_PHASE_TOUCH 2
+
+class CAP129nTuner
+{
+public:
+  // "sensitivity" is the SENSITIVITY_* setting the deltas are captured at
+  CAP129nTuner(uint8_t sensitivity = SENSITIVITY_32X);
+  void reset(uint8_t sensitivity);
+  void setMargins(uint16_t noiseMarginPercent, uint8_t detectPercent);
+
+  // Guided capture, one phase at a time
+  void beginIdle();
+  void beginTouch(uint8_t id);
+  void endPhase();
+  uint8_t getPhase();
+  bool update(CAP129n &device);	//One poll(deltas) sampled into the current phase, false on a failed read
+  void sample(const int8_t delta[8]);
+
+  // Direct feeds for recorded traces
+  void addIdle(const int8_t delta[8]);
+  void addTouch(uint8_t id, int8_t delta);
+
+  // False if no setting works for every touched input, the results are then from SENSITIVITY_1X
+  bool solve();
+  uint8_t getSensitivity();
+  uint8_t getThreshold(uint8_t id);	//0 for inputs without touch samples
+  uint8_t getTunedMask();
+  CAP129nConfig getConfig(const CAP129nConfig &base = CAP129nConfig());
+
+  // Per input, at the capture sensitivity
+  uint8_t getNoisePeak(uint8_t id);
+  uint8_t getSignal(uint8_t id);	//Mean touch delta
+  uint16_t getSNR(uint8_t id);		//Mean touch delta over RMS idle noise, x10
+  unsigned long getIdleSamples(uint8_t id);
+  unsigned long getTouchSamples(uint8_t id);
+
+private:
+  static uint16_t isqrt(uint32_t value);
+  static uint16_t scale(uint16_t value, int8_t shift, bool roundUp);
+
+  uint8_t _measured;
+  uint16_t _noiseMargin;
+  uint8_t _detect;
+  uint8_t _phase;
+  uint8_t _touchId;
+
+  unsigned long _idleCount[8];
+  unsigned long _idleSquares[8];
+  uint8_t _idlePeak[8];
+  unsigned long _touchCount[8];
+  unsigned long _touchSum[8];
+
+  uint8_t _sensitivity;
+  uint8_t _thresholds[8];
+};
+
+#endif